@@ -0,0 +1,166 @@
+#ifndef BFS_HPP
+#define BFS_HPP
+
+// Direction-optimizing breadth-first search for the Reach and Distance queries. A level
+// runs top-down (the frontier scans its out-edges) while the frontier is small, and
+// bottom-up (every unvisited vertex scans its in-edges until it finds a frontier vertex)
+// once the frontier's edges outnumber a fraction of the unexplored ones, which skips most
+// edges of the wide middle levels. Bottom-up levels keep the frontiers as bitsets and may
+// be split over several threads, each owning a range of bitset words.
+//
+// G needs getNumVertices(), getNumEdges() and nextOut(v, EdgeCursor &); R needs
+// nextIn(v, EdgeCursor &), both returning 0 at the end of the row, as DeltaGraph does.
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "DeltaGraph.hpp"
+
+// Scratch buffers of the search, reused across queries
+struct BfsWorkspace {
+    std::vector<int> depth;                // Hops from the nearest source, -1 when not reached
+    std::vector<uint64_t> visited;         // One bit per vertex id (ids 0 and > n set)
+    std::vector<uint64_t> frontier, next;  // Bottom-up frontiers, one bit per vertex id
+    std::vector<int> queue, nextQueue;     // Top-down frontiers
+};
+
+const int BFS_ALPHA = 14;  // Go bottom-up once the frontier has 1/ALPHA of the unexplored edges
+const int BFS_BETA = 24;   // Go back top-down once the frontier has under 1/BETA of the vertices
+
+inline bool testBit(const std::vector<uint64_t> &bits, int v) {
+    return (bits[v >> 6] >> (v & 63)) & 1;
+}
+
+inline void setBit(std::vector<uint64_t> &bits, int v) {
+    bits[v >> 6] |= uint64_t(1) << (v & 63);
+}
+
+// One top-down level from ws.queue; returns the size of the next frontier and counts the
+// edges it scanned into 'scanned'
+template <typename G>
+size_t bfsTopDown(const G &g, int level, BfsWorkspace &ws, size_t &scanned) {
+    ws.nextQueue.clear();
+    for (int v : ws.queue) {
+        EdgeCursor c;
+        for (int w = g.nextOut(v, c); w != 0; w = g.nextOut(v, c)) {
+            ++scanned;
+            if (!testBit(ws.visited, w)) {
+                setBit(ws.visited, w);
+                ws.depth[w] = level + 1;
+                ws.nextQueue.push_back(w);
+            }
+        }
+    }
+    ws.queue.swap(ws.nextQueue);
+    return ws.queue.size();
+}
+
+// One bottom-up level from ws.frontier on 'threads' workers; returns the size of the next
+// frontier
+template <typename R>
+size_t bfsBottomUp(const R &reverse, int level, int threads, BfsWorkspace &ws) {
+    size_t words = ws.visited.size();
+    ws.next.assign(words, 0);
+    std::vector<size_t> found(threads, 0);
+    auto work = [&](int t) {
+        for (size_t k = words * t / threads; k < words * (t + 1) / threads; ++k) {
+            for (uint64_t unvisited = ~ws.visited[k]; unvisited; unvisited &= unvisited - 1) {
+                int w = int(k * 64 + __builtin_ctzll(unvisited));
+                EdgeCursor c;
+                for (int u = reverse.nextIn(w, c); u != 0; u = reverse.nextIn(w, c)) {
+                    if (testBit(ws.frontier, u)) {
+                        ws.depth[w] = level + 1;
+                        setBit(ws.next, w);
+                        found[t]++;
+                        break;
+                    }
+                }
+            }
+            ws.visited[k] |= ws.next[k];  // Only this worker touches word k
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    ws.frontier.swap(ws.next);
+    size_t total = 0;
+    for (size_t f : found) {
+        total += f;
+    }
+    return total;
+}
+
+// Search from 'sources' (ids in 1..n) and fill ws.depth. Stops once 'target' (0 for none)
+// is reached. poll(reached) is called between levels with the number of vertices reached
+// so far; returns false when it asked to stop.
+template <typename G, typename R, typename Poll>
+bool bfs(const G &g, const R &reverse, const std::vector<int> &sources, int target, int threads, BfsWorkspace &ws,
+         Poll poll) {
+    int n = g.getNumVertices();
+    size_t words = size_t(n) / 64 + 1;
+    if (threads < 1 || words < 64 * size_t(threads)) {
+        threads = 1;  // Small graphs are not worth a thread start
+    }
+    ws.depth.assign(n + 1, -1);
+    ws.visited.assign(words, 0);
+    setBit(ws.visited, 0);
+    for (size_t v = n + 1; v < words * 64; ++v) {
+        setBit(ws.visited, int(v));
+    }
+    ws.queue.clear();
+    for (int s : sources) {
+        if (!testBit(ws.visited, s)) {
+            setBit(ws.visited, s);
+            ws.depth[s] = 0;
+            ws.queue.push_back(s);
+        }
+    }
+
+    double degree = n ? double(g.getNumEdges()) / n : 0;
+    size_t unexplored = g.getNumEdges();
+    bool bottomUp = false;
+    size_t frontierSize = ws.queue.size();
+    size_t reached = frontierSize;
+    for (int level = 0; frontierSize > 0 && !(target && ws.depth[target] >= 0); ++level) {
+        if (poll(reached)) {
+            return false;
+        }
+
+        // Switch direction when the frontier grew wide or shrank again
+        if (!bottomUp && frontierSize * degree > double(unexplored) / BFS_ALPHA) {
+            ws.frontier.assign(words, 0);
+            for (int v : ws.queue) {
+                setBit(ws.frontier, v);
+            }
+            bottomUp = true;
+        } else if (bottomUp && frontierSize < size_t(n) / BFS_BETA) {
+            ws.queue.clear();
+            for (size_t k = 0; k < words; ++k) {
+                for (uint64_t bits = ws.frontier[k]; bits; bits &= bits - 1) {
+                    ws.queue.push_back(int(k * 64 + __builtin_ctzll(bits)));
+                }
+            }
+            bottomUp = false;
+        }
+
+        size_t scanned = 0;
+        if (bottomUp) {
+            frontierSize = bfsBottomUp(reverse, level, threads, ws);
+            scanned = size_t(frontierSize * degree);  // Estimate: the new frontier's edges
+        } else {
+            frontierSize = bfsTopDown(g, level, ws, scanned);
+        }
+        unexplored -= scanned < unexplored ? scanned : unexplored;
+        reached += frontierSize;
+    }
+    return true;
+}
+
+#endif
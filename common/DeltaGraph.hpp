@@ -0,0 +1,476 @@
+#ifndef DELTA_GRAPH_HPP
+#define DELTA_GRAPH_HPP
+
+// Mutable directed graph (1-based vertex ids, parallel edges allowed) kept as a
+// read-optimized CSR base plus a small delta of the updates made since the base was
+// built: tombstones over removed base edges and the inserted edges, indexed by source
+// and by target. Traversals merge base and delta on the fly.
+//
+// Every update is also appended to a log. Once the log outgrows the threshold, a
+// background thread replays it over the base into a fresh CSR; the next update installs
+// that CSR and replays the few updates made while it was built. A mutation therefore
+// never pays for more than the delta, and traversals never walk a long delta.
+//
+// Out-neighbors come in the order the edges were added, a removal drops the first
+// remaining u -> v edge, and in-neighbors come sorted by source, so every query sees the
+// same lists whether or not a compaction happened in between.
+//
+// Not thread-safe: the owner serializes updates against traversals (an update may
+// install a compaction), exactly as for a plain adjacency list.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Position in the neighbor list of one vertex during a traversal
+struct EdgeCursor {
+    size_t base = 0;   // Next entry of the CSR row
+    size_t delta = 0;  // Next entry of the delta list
+};
+
+class DeltaGraph {
+    // One logged update
+    struct Update {
+        int u, v;
+        bool insert;
+    };
+
+    // Immutable CSR of the graph as of one compaction. In-rows list the sources in
+    // increasing order, each with the position of its edge in the out-rows, so a removal
+    // finds the edge by binary search.
+    struct Base {
+        int n = 0;
+        std::vector<size_t> outOffsets;  // n + 2 entries
+        std::vector<int> targets;
+        std::vector<size_t> inOffsets;   // n + 2 entries
+        std::vector<int> sources;
+        std::vector<size_t> edgeOf;      // Position in 'targets' of every in-entry's edge
+
+        // Fill the in-rows from the out-rows; scanning the sources in increasing order
+        // sorts every in-row
+        void buildInRows() {
+            inOffsets.assign(n + 2, 0);
+            for (int v : targets) {
+                inOffsets[v + 1]++;
+            }
+            fillInRows();
+        }
+
+        // Lay out 'edges', with the out- and in-degree of every vertex already counted in
+        // outOffsets[u + 1] and inOffsets[v + 1]; out-rows keep the order of 'edges'
+        void fill(const std::vector<std::pair<int, int>> &edges) {
+            for (int u = 1; u <= n + 1; ++u) {
+                outOffsets[u] += outOffsets[u - 1];
+            }
+            targets.resize(edges.size());
+            std::vector<size_t> next(outOffsets.begin(), outOffsets.end() - 1);
+            for (const auto &e : edges) {
+                targets[next[e.first]++] = e.second;
+            }
+            fillInRows();
+        }
+
+        // buildInRows with the in-degree of every vertex v counted in inOffsets[v + 1]
+        void fillInRows() {
+            for (int v = 1; v <= n + 1; ++v) {
+                inOffsets[v] += inOffsets[v - 1];
+            }
+            sources.resize(targets.size());
+            edgeOf.resize(targets.size());
+            std::vector<size_t> next(inOffsets.begin(), inOffsets.end() - 1);
+            for (int u = 1; u <= n; ++u) {
+                for (size_t e = outOffsets[u]; e < outOffsets[u + 1]; ++e) {
+                    size_t k = next[targets[e]]++;
+                    sources[k] = u;
+                    edgeOf[k] = e;
+                }
+            }
+        }
+    };
+
+    static constexpr uint8_t HAS_OUT = 1;   // The delta holds edges out of the vertex
+    static constexpr uint8_t HAS_IN = 2;    // The delta holds edges into the vertex
+    static constexpr size_t DELTA_ROW_BYTES = 64;  // Hash node and row header of one delta row
+
+    // A base and what changed since it was built
+    struct State {
+        std::shared_ptr<const Base> base;
+        std::vector<uint8_t> dead;     // One tombstone flag per base edge
+        size_t tombstones = 0;
+        std::vector<uint8_t> touched;  // HAS_OUT | HAS_IN flags per vertex
+        std::unordered_map<int, std::vector<int>> outDelta;  // Inserted targets by source, in order
+        // Inserted sources by target, sorted unless listed in dirtyIn. The traversal that
+        // sorts them only holds a shared lock, so the dirty flags are kept apart from
+        // 'touched', which other traversals read meanwhile.
+        mutable std::unordered_map<int, std::vector<int>> inDelta;
+        mutable std::vector<uint8_t> inDirty;  // 1 per vertex whose in-row is in dirtyIn
+        mutable std::vector<int> dirtyIn;      // Vertices appended to since their in-row was sorted
+        size_t edges = 0;
+
+        explicit State(std::shared_ptr<const Base> b) : base(std::move(b)) {
+            dead.assign(base->targets.size(), 0);
+            touched.assign(base->n + 1, 0);
+            inDirty.assign(base->n + 1, 0);
+            edges = base->targets.size();
+        }
+
+        void apply(const Update &e) {
+            if (e.insert) {
+                // The source is appended and the row sorted before the next in-traversal:
+                // a sorted insert would cost the row's length for every edge into a hub
+                outDelta[e.u].push_back(e.v);
+                inDelta[e.v].push_back(e.u);
+                if (!inDirty[e.v]) {
+                    inDirty[e.v] = 1;
+                    dirtyIn.push_back(e.v);
+                }
+                touched[e.u] |= HAS_OUT;
+                touched[e.v] |= HAS_IN;
+                ++edges;
+                return;
+            }
+
+            // The first live u -> v edge of the base row, found through the in-row of v
+            const Base &b = *base;
+            auto first = b.sources.begin() + b.inOffsets[e.v];
+            auto last = b.sources.begin() + b.inOffsets[e.v + 1];
+            for (auto it = std::lower_bound(first, last, e.u); it != last && *it == e.u; ++it) {
+                size_t edge = b.edgeOf[it - b.sources.begin()];
+                if (!dead[edge]) {
+                    dead[edge] = 1;
+                    ++tombstones;
+                    --edges;
+                    return;
+                }
+            }
+
+            // Otherwise the first one inserted since the base was built
+            if (touched[e.u] & HAS_OUT) {
+                std::vector<int> &out = outDelta[e.u];
+                auto it = std::find(out.begin(), out.end(), e.v);
+                if (it != out.end()) {
+                    out.erase(it);
+                    std::vector<int> &in = inDelta[e.v];
+                    in.erase(std::find(in.begin(), in.end(), e.u));
+                    --edges;
+                }
+            }
+        }
+
+        // Sort the delta in-rows that were appended to
+        void sortIn() const {
+            for (int v : dirtyIn) {
+                std::vector<int> &in = inDelta.at(v);
+                std::sort(in.begin(), in.end());
+                inDirty[v] = 0;
+            }
+            dirtyIn.clear();
+        }
+
+        // The live edges as a fresh base: every out-row keeps its base edges, then its
+        // inserted ones
+        std::shared_ptr<Base> flatten() const {
+            const Base &b = *base;
+            std::shared_ptr<Base> next = std::make_shared<Base>();
+            next->n = b.n;
+            next->outOffsets.assign(b.n + 2, 0);
+            next->targets.reserve(edges);
+            for (int u = 1; u <= b.n; ++u) {
+                next->outOffsets[u] = next->targets.size();
+                for (size_t e = b.outOffsets[u]; e < b.outOffsets[u + 1]; ++e) {
+                    if (!dead[e]) {
+                        next->targets.push_back(b.targets[e]);
+                    }
+                }
+                if (touched[u] & HAS_OUT) {
+                    const std::vector<int> &out = outDelta.at(u);
+                    next->targets.insert(next->targets.end(), out.begin(), out.end());
+                }
+            }
+            next->outOffsets[b.n + 1] = next->targets.size();
+            next->buildInRows();
+            return next;
+        }
+    };
+
+    // A compaction on its background thread. The thread only touches this object, so the
+    // graph may be replaced or destroyed while it runs.
+    struct Compaction {
+        std::mutex lock;
+        std::unique_ptr<State> result;  // Set by the thread when done
+        size_t covered = 0;             // Logged updates the result includes
+    };
+
+    // A compaction starts once the log holds an eighth of the base, and at least this many
+    static constexpr size_t MIN_COMPACT_UPDATES = 1 << 12;
+
+    // Lets the first of several concurrent traversals sort the delta in-rows
+    struct InSort {
+        std::mutex lock;
+        std::atomic<bool> pending{false};  // state.dirtyIn is not empty
+    };
+
+    State state;
+    std::vector<Update> log;                 // Every update since state.base was built
+    std::shared_ptr<Compaction> compaction;  // Running or finished, null when none
+    std::unique_ptr<InSort> inSort{new InSort};
+
+    static std::shared_ptr<Base> emptyBase(int n) {
+        std::shared_ptr<Base> base = std::make_shared<Base>();
+        base->n = n;
+        base->outOffsets.assign(n + 2, 0);
+        base->inOffsets.assign(n + 2, 0);
+        return base;
+    }
+
+    static void compact(std::shared_ptr<Compaction> job, std::shared_ptr<const Base> base,
+                        std::vector<Update> updates) {
+        State replayed(base);
+        for (const Update &e : updates) {
+            replayed.apply(e);
+        }
+        std::unique_ptr<State> next(new State(replayed.flatten()));
+        std::lock_guard<std::mutex> lock(job->lock);
+        job->result = std::move(next);
+    }
+
+    // Switch to the finished compaction, if any, and replay the updates it missed
+    void installCompaction() {
+        std::unique_ptr<State> next;
+        {
+            std::lock_guard<std::mutex> lock(compaction->lock);
+            next = std::move(compaction->result);
+        }
+        if (!next) {
+            return;  // Still running
+        }
+        for (size_t i = compaction->covered; i < log.size(); ++i) {
+            next->apply(log[i]);
+        }
+        log.erase(log.begin(), log.begin() + compaction->covered);
+        state = std::move(*next);
+        compaction.reset();
+    }
+
+    void update(const Update &e) {
+        if (compaction) {
+            installCompaction();
+        }
+        state.apply(e);
+        if (!state.dirtyIn.empty()) {
+            inSort->pending.store(true, std::memory_order_relaxed);  // Readers come after the owner's lock
+        }
+        log.push_back(e);
+        size_t threshold = state.base->targets.size() / 8;
+        if (threshold < MIN_COMPACT_UPDATES) {
+            threshold = MIN_COMPACT_UPDATES;
+        }
+        if (!compaction && log.size() >= threshold) {
+            compaction = std::make_shared<Compaction>();
+            compaction->covered = log.size();
+            std::thread(compact, compaction, state.base, log).detach();
+        }
+    }
+
+    // Sort the delta in-rows appended to since the last traversal. Traversals may run
+    // concurrently (updates may not), so the first one sorts while the others wait.
+    void sortInRows() const {
+        std::lock_guard<std::mutex> lock(inSort->lock);
+        if (inSort->pending.load(std::memory_order_relaxed)) {
+            state.sortIn();
+            inSort->pending.store(false, std::memory_order_release);
+        }
+    }
+
+    bool inRange(int u, int v) const {
+        return u >= 1 && u <= state.base->n && v >= 1 && v <= state.base->n;
+    }
+
+    // Graph over a base built elsewhere
+    explicit DeltaGraph(std::shared_ptr<const Base> base) : state(std::move(base)) {
+    }
+
+public:
+    // Graph with 'n' vertices and no edges
+    explicit DeltaGraph(int n = 0) : state(emptyBase(n)) {
+    }
+
+    // Collects the edges of a new graph one at a time and counts the degrees as they
+    // come, so only the scatter into the rows is left once the last one is in
+    class Builder {
+        std::shared_ptr<Base> base;  // Degree counts so far in outOffsets and inOffsets
+        std::vector<std::pair<int, int>> edges;
+
+    public:
+        // 'expected' edges are reserved up to a limit, so a bad count cannot allocate
+        // more than the edges that actually arrive
+        explicit Builder(int n, size_t expected = 0) : base(emptyBase(n)) {
+            edges.reserve(std::min(expected, size_t(1) << 20));
+        }
+
+        // Add u -> v; returns false, adding nothing, when a vertex is out of range
+        bool add(int u, int v) {
+            if (u < 1 || u > base->n || v < 1 || v > base->n) {
+                return false;
+            }
+            edges.emplace_back(u, v);
+            base->outOffsets[u + 1]++;
+            base->inOffsets[v + 1]++;
+            return true;
+        }
+
+        size_t size() const {
+            return edges.size();
+        }
+
+        // The graph of the edges added so far; out-rows keep the order they came in
+        DeltaGraph build() {
+            base->fill(edges);
+            DeltaGraph g(base);
+            *this = Builder(base->n);
+            return g;
+        }
+    };
+
+    // Graph with 'n' vertices built straight into the base; out-rows keep the order of
+    // 'edges'
+    DeltaGraph(int n, const std::vector<std::pair<int, int>> &edges) : state(emptyBase(0)) {
+        std::shared_ptr<Base> base = emptyBase(n);
+        for (const auto &e : edges) {
+            base->outOffsets[e.first + 1]++;
+            base->inOffsets[e.second + 1]++;
+        }
+        base->fill(edges);
+        state = State(base);
+    }
+
+    // Add u -> v; returns false, changing nothing, when a vertex is out of range
+    bool addEdge(int u, int v) {
+        if (!inRange(u, v)) {
+            return false;
+        }
+        update({u, v, true});
+        return true;
+    }
+
+    // Remove the first u -> v edge, if there is one; returns false, changing nothing,
+    // when a vertex is out of range
+    bool removeEdge(int u, int v) {
+        if (!inRange(u, v)) {
+            return false;
+        }
+        update({u, v, false});
+        return true;
+    }
+
+    // Apply a batch of updates as one transaction: every update is applied in order, or
+    // none is when a vertex is out of range
+    template <typename U>
+    bool applyBatch(const std::vector<U> &updates) {
+        for (const U &e : updates) {
+            if (!inRange(e.u, e.v)) {
+                return false;
+            }
+        }
+        for (const U &e : updates) {
+            update({e.u, e.v, e.insert});
+        }
+        return true;
+    }
+
+    int getNumVertices() const {
+        return state.base->n;
+    }
+
+    size_t getNumEdges() const {
+        return state.edges;
+    }
+
+    // Updates not yet folded into the CSR base
+    size_t getDeltaSize() const {
+        return log.size();
+    }
+
+    // Bytes the graph holds: the CSR rows both ways, the tombstones, the delta and the
+    // log. Delta rows are counted at a fixed estimate per row, so this stays O(1); a
+    // compaction still running holds a second base for a while that is not counted.
+    size_t memoryBytes() const {
+        const Base &b = *state.base;
+        size_t inserted = state.edges + state.tombstones - b.targets.size();
+        return (b.outOffsets.capacity() + b.inOffsets.capacity() + b.edgeOf.capacity()) * sizeof(size_t) +
+               (b.targets.capacity() + b.sources.capacity()) * sizeof(int) + state.dead.capacity() +
+               state.touched.capacity() + state.inDirty.capacity() +
+               (state.outDelta.size() + state.inDelta.size()) * DELTA_ROW_BYTES +
+               2 * inserted * sizeof(int) + log.capacity() * sizeof(Update);
+    }
+
+    // memoryBytes of a freshly built graph with 'n' vertices and 'm' edges
+    static size_t estimateBytes(int n, size_t m) {
+        return 2 * (size_t(n) + 2) * sizeof(size_t) + 2 * (size_t(n) + 1) + m * (2 * sizeof(int) + sizeof(size_t) + 1);
+    }
+
+    // Call f(v) for every out-neighbor of 'u', in order
+    template <typename F>
+    void forEachOut(int u, F f) const {
+        const Base &b = *state.base;
+        for (size_t e = b.outOffsets[u]; e < b.outOffsets[u + 1]; ++e) {
+            if (!state.dead[e]) {
+                f(b.targets[e]);
+            }
+        }
+        if (state.touched[u] & HAS_OUT) {
+            for (int v : state.outDelta.at(u)) {
+                f(v);
+            }
+        }
+    }
+
+    // The out-neighbor of 'v' at cursor 'c', advancing it; 0 once the row is done
+    int nextOut(int v, EdgeCursor &c) const {
+        const Base &b = *state.base;
+        for (size_t e = b.outOffsets[v] + c.base; e < b.outOffsets[v + 1]; ++e) {
+            c.base++;
+            if (!state.dead[e]) {
+                return b.targets[e];
+            }
+        }
+        if (state.touched[v] & HAS_OUT) {
+            const std::vector<int> &out = state.outDelta.at(v);
+            if (c.delta < out.size()) {
+                return out[c.delta++];
+            }
+        }
+        return 0;
+    }
+
+    // The in-neighbor of 'v' at cursor 'c', advancing it; 0 once the row is done. The base
+    // and delta in-rows are merged by source.
+    int nextIn(int v, EdgeCursor &c) const {
+        if (inSort->pending.load(std::memory_order_acquire)) {
+            sortInRows();
+        }
+        const Base &b = *state.base;
+        size_t e = b.inOffsets[v] + c.base;
+        size_t end = b.inOffsets[v + 1];
+        while (state.tombstones && e < end && state.dead[b.edgeOf[e]]) {
+            ++e;
+            c.base++;
+        }
+        const std::vector<int> *in = (state.touched[v] & HAS_IN) ? &state.inDelta.at(v) : nullptr;
+        bool fromDelta = in && c.delta < in->size();
+        if (e < end && (!fromDelta || b.sources[e] <= (*in)[c.delta])) {
+            c.base++;
+            return b.sources[e];
+        }
+        return fromDelta ? (*in)[c.delta++] : 0;
+    }
+};
+
+#endif
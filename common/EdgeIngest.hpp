@@ -0,0 +1,175 @@
+#ifndef EDGE_INGEST_HPP
+#define EDGE_INGEST_HPP
+
+// Pipelined upload of a new graph ("Newgraph n m"): the receiving thread hands over the
+// input as it arrives, a parser thread turns text into edges and a builder thread counts
+// the degrees edge by edge, the stages linked by bounded lock-free queues. Once the m-th
+// edge is in the builder only has to scatter the rows, so the graph is ready about as
+// soon as the last byte arrived instead of after a receive, a parse and a build in turn.
+//
+// The text is whitespace separated vertex ids; whatever follows the m-th edge is ignored.
+// Binary input (pairs already parsed, as from a shared memory ring) skips the parser.
+// Use either feed or feedEdges for one upload, from a single thread.
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "DeltaGraph.hpp"
+#include "SpscQueue.hpp"
+
+class EdgeIngest {
+    struct Chunk {
+        std::string text;
+        bool last = false;  // The input ended
+    };
+
+    struct EdgeBlock {
+        std::vector<std::pair<int, int>> edges;
+        bool last = false;
+    };
+
+    static constexpr size_t BLOCK_EDGES = 1 << 12;  // Edges the parser hands over at a time
+
+    size_t m;
+    DeltaGraph::Builder builder;
+    std::function<void(DeltaGraph &)> onBuilt;
+    SpscQueue<Chunk, 64> chunks;         // Receiver -> parser
+    SpscQueue<EdgeBlock, 64> blocks;     // Parser (or receiver, for binary input) -> builder
+    std::thread parser, builderThread;
+    std::atomic<bool> malformed{false};  // Set by the parser before it hands over the block
+    bool valid = true;                   // Builder thread only until it is joined
+    bool built = false;
+    DeltaGraph graph;
+
+    void parse() {
+        EdgeBlock block;
+        size_t parsed = 0;
+        long long value = 0;  // Token so far, which may continue in the next chunk
+        bool inToken = false;
+        int field = 0;        // 0 source, 1 target
+        std::pair<int, int> edge;
+        auto endToken = [&]() {
+            if (!inToken) {
+                return;
+            }
+            inToken = false;
+            int id = value > INT_MAX ? -1 : int(value);
+            value = 0;
+            if (field == 0) {
+                edge.first = id;
+                field = 1;
+                return;
+            }
+            edge.second = id;
+            field = 0;
+            block.edges.push_back(edge);
+            if (++parsed == m || block.edges.size() == BLOCK_EDGES) {
+                blocks.push(std::move(block));
+                block = EdgeBlock();
+            }
+        };
+
+        for (;;) {
+            Chunk chunk = chunks.pop();
+            for (size_t i = 0; i < chunk.text.size() && parsed < m; ++i) {
+                char c = chunk.text[i];
+                if (c >= '0' && c <= '9') {
+                    value = value > INT_MAX ? value : value * 10 + (c - '0');
+                    inToken = true;
+                } else if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+                    endToken();
+                } else {
+                    malformed.store(true, std::memory_order_relaxed);
+                }
+            }
+            if (chunk.last) {
+                if (parsed < m) {
+                    endToken();  // The input may end in the last target
+                }
+                block.last = true;
+                blocks.push(std::move(block));
+                return;
+            }
+        }
+    }
+
+    // Lay out the graph once all m edges are in
+    void buildWhenComplete() {
+        if (!built && valid && builder.size() == m) {
+            graph = builder.build();
+            built = true;
+            if (onBuilt) {
+                onBuilt(graph);
+            }
+        }
+    }
+
+    void build() {
+        size_t seen = 0;
+        for (bool last = false; !last;) {
+            buildWhenComplete();
+            EdgeBlock block = blocks.pop();
+            valid = valid && !malformed.load(std::memory_order_relaxed);
+            for (const auto &e : block.edges) {
+                if (seen++ < m) {
+                    valid = builder.add(e.first, e.second) && valid;
+                }
+            }
+            last = block.last;
+        }
+        buildWhenComplete();
+    }
+
+public:
+    // Upload of a graph with 'n' vertices and 'm' edges. onBuilt, when given, runs on the
+    // builder thread with the graph as soon as its last edge is in.
+    EdgeIngest(int n, size_t m, std::function<void(DeltaGraph &)> onBuilt = nullptr)
+        : m(m), builder(n, m), onBuilt(std::move(onBuilt)) {
+        builderThread = std::thread(&EdgeIngest::build, this);
+    }
+
+    ~EdgeIngest() {
+        DeltaGraph unused;
+        finish(unused);
+    }
+
+    // Hand over the next piece of text; waits while the parser is far behind
+    void feed(const char *data, size_t size) {
+        if (!parser.joinable()) {
+            parser = std::thread(&EdgeIngest::parse, this);
+        }
+        chunks.push({std::string(data, size), false});
+    }
+
+    // Hand over parsed edges
+    void feedEdges(std::vector<std::pair<int, int>> edges) {
+        blocks.push({std::move(edges), false});
+    }
+
+    // End the input and wait for the stages. Returns whether m well formed edges arrived;
+    // the graph then goes to 'g', unless onBuilt took it.
+    bool finish(DeltaGraph &g) {
+        if (!builderThread.joinable()) {
+            return built;
+        }
+        if (parser.joinable()) {
+            chunks.push({std::string(), true});
+            parser.join();
+        } else {
+            blocks.push({{}, true});
+        }
+        builderThread.join();
+        if (built && !onBuilt) {
+            g = std::move(graph);
+        }
+        return built;
+    }
+};
+
+#endif
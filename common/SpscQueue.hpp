@@ -0,0 +1,69 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+// Bounded single-producer single-consumer queue between two threads: a ring of slots
+// where only the producer moves 'head' and only the consumer moves 'tail', so neither
+// side takes a lock. A side that finds the ring full (empty) spins briefly, then sleeps
+// in growing steps until the other side moves; a full ring throttles the producer.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    T slots[Capacity];
+    alignas(64) std::atomic<size_t> head{0};  // Slots ever pushed
+    alignas(64) std::atomic<size_t> tail{0};  // Slots ever popped
+
+    // Wait between two attempts; 'attempt' counts the failed ones
+    static void backOff(int attempt) {
+        if (attempt < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min(1000, 10 << std::min(attempt - 64, 7))));
+        }
+    }
+
+public:
+    bool tryPush(T &value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[h & (Capacity - 1)] = std::move(value);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[t & (Capacity - 1)]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        for (int attempt = 0; !tryPush(value); ++attempt) {
+            backOff(attempt);
+        }
+    }
+
+    T pop() {
+        T value;
+        for (int attempt = 0; !tryPop(value); ++attempt) {
+            backOff(attempt);
+        }
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Scoped trace spans for the SCC pipeline, written as a Chrome trace / Perfetto JSON file.
+//
+//   TRACE_SPAN("transpose");   // Times the rest of the enclosing scope
+//
+// Tracing is compiled in only when SCC_TRACE is defined (make TRACE=1); otherwise the
+// macros expand to nothing. Events go to $SCC_TRACE_FILE (default trace.json) when the
+// program exits or TRACE_FLUSH() is called; every flush appends only the events recorded
+// since the previous one. Programs that never exit normally call TRACE_FLUSH_EVERY(ms)
+// once instead. When perf_event_open is allowed, every span also carries the cycles,
+// instructions and cache misses of its thread.
+
+#ifdef SCC_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace trace {
+
+// One completed span
+struct Event {
+    const char *name;
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint64_t counters[3];  // cycles, instructions, cache misses
+    bool hasCounters;
+};
+
+const int COUNTER_COUNT = 3;
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "cache_misses"};
+
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Hardware counters of the calling thread, opened as one perf event group
+class Counters {
+    int leader = -1;
+    int members[COUNTER_COUNT] = {-1, -1, -1};
+
+    static int open(uint64_t config, int group) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = group == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+public:
+    Counters() {
+        const uint64_t configs[COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                 PERF_COUNT_HW_CACHE_MISSES};
+        leader = open(configs[0], -1);
+        if (leader < 0) {
+            return;  // No PMU access (container, VM or perf_event_paranoid); spans keep only times
+        }
+        members[0] = leader;
+        for (int i = 1; i < COUNTER_COUNT; ++i) {
+            members[i] = open(configs[i], leader);
+            if (members[i] < 0) {
+                close();
+                return;
+            }
+        }
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~Counters() {
+        close();
+    }
+
+    void close() {
+        for (int i = COUNTER_COUNT - 1; i >= 0; --i) {
+            if (members[i] >= 0) {
+                ::close(members[i]);
+                members[i] = -1;
+            }
+        }
+        leader = -1;
+    }
+
+    bool read(uint64_t *values) const {
+        if (leader < 0) {
+            return false;
+        }
+        uint64_t buffer[1 + COUNTER_COUNT];
+        if (::read(leader, buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer) || buffer[0] != COUNTER_COUNT) {
+            return false;
+        }
+        std::memcpy(values, buffer + 1, sizeof(uint64_t) * COUNTER_COUNT);
+        return true;
+    }
+};
+
+// Events of one thread not flushed yet
+struct ThreadBuffer {
+    uint32_t tid;
+    std::vector<Event> events;
+    bool finished = false;  // Its thread exited; freed by the next flush
+};
+
+// Process-wide list of thread buffers. A flush moves the new events out of them and
+// appends them to the trace file, which stays valid JSON in between flushes.
+class Recorder {
+    std::mutex lock;       // Guards the buffers
+    std::mutex fileLock;   // Held by the flush writing the file
+    std::vector<ThreadBuffer *> buffers;
+    uint64_t origin = nowNs();
+    std::ofstream out;
+    bool written = false;  // Whether an event is in the file yet
+
+    static constexpr const char *TRAILER = "\n]}\n";
+
+    // Hands the buffer of a thread back when the thread exits
+    struct Owner {
+        ThreadBuffer *buffer = nullptr;
+        ~Owner() {
+            if (buffer) {
+                Recorder::instance().release(buffer);
+            }
+        }
+    };
+
+    void release(ThreadBuffer *buffer) {
+        std::lock_guard<std::mutex> guard(lock);
+        buffer->finished = true;
+    }
+
+public:
+    static Recorder &instance() {
+        static Recorder *recorder = [] {
+            Recorder *r = new Recorder;
+            std::atexit([] { Recorder::instance().flush(); });
+            return r;
+        }();
+        return *recorder;
+    }
+
+    ThreadBuffer &local() {
+        thread_local Owner owner;
+        if (!owner.buffer) {
+            owner.buffer = new ThreadBuffer;
+            owner.buffer->tid = syscall(SYS_gettid);
+            std::lock_guard<std::mutex> guard(lock);
+            buffers.push_back(owner.buffer);
+        }
+        return *owner.buffer;
+    }
+
+    void record(const Event &event) {
+        ThreadBuffer &buffer = local();
+        std::lock_guard<std::mutex> guard(lock);  // Only contended while a flush collects events
+        buffer.events.push_back(event);
+    }
+
+    // Append the events recorded since the last flush to the trace file
+    void flush() {
+        std::lock_guard<std::mutex> fileGuard(fileLock);
+        std::vector<std::pair<uint32_t, std::vector<Event>>> pending;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (size_t i = 0; i < buffers.size();) {
+                ThreadBuffer *buffer = buffers[i];
+                if (!buffer->events.empty()) {
+                    pending.emplace_back(buffer->tid, std::vector<Event>());
+                    pending.back().second.swap(buffer->events);
+                }
+                if (buffer->finished) {
+                    delete buffer;
+                    buffers[i] = buffers.back();
+                    buffers.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        if (!out.is_open()) {
+            const char *path = std::getenv("SCC_TRACE_FILE");
+            out.open(path ? path : "trace.json");
+            out.setf(std::ios::fixed);
+            out.precision(3);
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        } else if (pending.empty()) {
+            return;
+        } else {
+            out.seekp(-(std::streamoff)std::strlen(TRAILER), std::ios::end);  // Overwrite the closing brackets
+        }
+        for (const auto &thread : pending) {
+            for (const Event &e : thread.second) {
+                out << (written ? ",\n" : "\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":" << getpid()
+                    << ",\"tid\":" << thread.first << ",\"ts\":" << int64_t(e.startNs - origin) / 1000.0
+                    << ",\"dur\":" << e.durationNs / 1000.0;
+                if (e.hasCounters) {
+                    out << ",\"args\":{";
+                    for (int i = 0; i < COUNTER_COUNT; ++i) {
+                        out << (i ? "," : "") << "\"" << COUNTER_NAMES[i] << "\":" << e.counters[i];
+                    }
+                    out << "}";
+                }
+                out << "}";
+                written = true;
+            }
+        }
+        out << TRAILER;
+        out.flush();
+    }
+
+    // Flush every 'period' from a background thread
+    void flushEvery(std::chrono::milliseconds period) {
+        std::thread([this, period] {
+            while (true) {
+                std::this_thread::sleep_for(period);
+                flush();
+            }
+        }).detach();
+    }
+};
+
+// Times the enclosing scope and records it as one complete ("X") event
+class Span {
+    Event event;
+
+    static const Counters &counters() {
+        thread_local Counters perThread;
+        return perThread;
+    }
+
+public:
+    explicit Span(const char *name) {
+        Recorder::instance();  // Fixes the time origin before the first span starts
+        event.name = name;
+        event.hasCounters = counters().read(event.counters);
+        event.startNs = nowNs();
+    }
+
+    ~Span() {
+        event.durationNs = nowNs() - event.startNs;
+        uint64_t end[COUNTER_COUNT];
+        if (event.hasCounters && counters().read(end)) {
+            for (int i = 0; i < COUNTER_COUNT; ++i) {
+                event.counters[i] = end[i] - event.counters[i];
+            }
+        } else {
+            event.hasCounters = false;
+        }
+        Recorder::instance().record(event);
+    }
+};
+
+}  // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) trace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_FLUSH() trace::Recorder::instance().flush()
+#define TRACE_FLUSH_EVERY(ms) trace::Recorder::instance().flushEvery(std::chrono::milliseconds(ms))
+
+#else
+
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_FLUSH() ((void)0)
+#define TRACE_FLUSH_EVERY(ms) ((void)0)
+
+#endif
+
+#endif
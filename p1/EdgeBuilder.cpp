@@ -0,0 +1,167 @@
+#include "EdgeBuilder.hpp"
+#include "../common/Trace.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const int DIGIT_BITS = 11;  // 2048 buckets: one worker's histogram fits in L1
+const size_t RADIX = size_t(1) << DIGIT_BITS;
+
+// Run body(worker, from, to) on 'threads' workers, each over one equal slice of
+// [0, count). One worker runs on the calling thread.
+template <class Body>
+void parallelChunks(size_t count, int threads, Body body) {
+    if (threads <= 1) {
+        body(0, size_t(0), count);
+        return;
+    }
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            body(t, count * t / threads, count * (t + 1) / threads);
+        });
+    }
+    body(0, size_t(0), count / threads);
+    for (thread &worker : workers) {
+        worker.join();
+    }
+}
+
+// One stable LSD pass on the digit at 'shift', from 'in' to 'out'. Every worker
+// histograms its slice, the histograms are turned into one start per (digit, worker)
+// in digit-major order, and every worker scatters its slice into its own slots.
+// Returns false, having moved nothing, when all keys share the digit.
+bool radixPass(const vector<uint64_t> &in, vector<uint64_t> &out, int shift, int threads) {
+    vector<size_t> counts(threads * RADIX, 0);
+    parallelChunks(in.size(), threads, [&](int t, size_t from, size_t to) {
+        size_t *count = &counts[t * RADIX];
+        for (size_t i = from; i < to; ++i) {
+            count[(in[i] >> shift) & (RADIX - 1)]++;
+        }
+    });
+
+    size_t sum = 0;
+    for (size_t d = 0; d < RADIX; ++d) {
+        size_t digitTotal = 0;
+        for (int t = 0; t < threads; ++t) {
+            size_t count = counts[t * RADIX + d];
+            counts[t * RADIX + d] = sum;
+            sum += count;
+            digitTotal += count;
+        }
+        if (digitTotal == in.size()) {
+            return false;
+        }
+    }
+
+    parallelChunks(in.size(), threads, [&](int t, size_t from, size_t to) {
+        size_t *next = &counts[t * RADIX];
+        for (size_t i = from; i < to; ++i) {
+            out[next[(in[i] >> shift) & (RADIX - 1)]++] = in[i];
+        }
+    });
+    return true;
+}
+
+inline uint32_t sourceOf(uint64_t key) {
+    return uint32_t(key >> 32);
+}
+
+inline uint32_t targetOf(uint64_t key) {
+    return uint32_t(key & 0xffffffffu);
+}
+
+}  // namespace
+
+template <class V>
+BuildStats buildCSR(uint32_t n, vector<uint64_t> &edges, const BuildOptions &options, GraphArray<size_t> &offsets,
+                    GraphArray<V> &targets) {
+    int threads = max(1, options.threads);
+    if (edges.size() < (size_t(1) << 16)) {
+        threads = 1;  // Small graphs are not worth a thread start
+    }
+
+    // Only the digits a vertex id can use are sorted: the target digits first, then the
+    // source digits
+    {
+        TRACE_SPAN("radix sort");
+        int bits = 1;
+        while (bits < 32 && (uint64_t(1) << bits) <= uint64_t(n)) {
+            ++bits;
+        }
+        vector<uint64_t> scratch(edges.size());
+        for (int half = 0; half < 64; half += 32) {
+            for (int shift = 0; shift < bits; shift += DIGIT_BITS) {
+                if (radixPass(edges, scratch, half + shift, threads)) {
+                    edges.swap(scratch);
+                }
+            }
+        }
+    }
+
+    // Every worker counts the edges its slice keeps, a prefix sum over the slices gives
+    // each one its output position, and the slices are compacted in parallel. A vertex's
+    // offset is the output position of the first of its edges in sorted order; the
+    // vertices in between two sources get the same position.
+    TRACE_SPAN("compact");
+    bool dropSelfLoops = options.dropSelfLoops;
+    auto keep = [&](size_t i) {
+        return (i == 0 || edges[i] != edges[i - 1]) && !(dropSelfLoops && sourceOf(edges[i]) == targetOf(edges[i]));
+    };
+
+    vector<size_t> kept(threads + 1, 0);
+    vector<BuildStats> stats(threads);
+    parallelChunks(edges.size(), threads, [&](int t, size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            if (keep(i)) {
+                kept[t + 1]++;
+            } else if (i > 0 && edges[i] == edges[i - 1]) {
+                stats[t].duplicates++;
+            } else {
+                stats[t].selfLoops++;
+            }
+        }
+    });
+    for (int t = 0; t < threads; ++t) {
+        kept[t + 1] += kept[t];
+    }
+
+    offsets.assign(n + 2, 0);
+    targets.resize(kept[threads]);
+    parallelChunks(edges.size(), threads, [&](int t, size_t from, size_t to) {
+        size_t next = kept[t];
+        for (size_t i = from; i < to; ++i) {
+            uint64_t u = sourceOf(edges[i]);
+            uint64_t previous = i == 0 ? 0 : sourceOf(edges[i - 1]);
+            for (uint64_t w = previous + 1; w <= u; ++w) {
+                offsets[w] = next;
+            }
+            if (keep(i)) {
+                targets[next++] = targetOf(edges[i]);
+            }
+        }
+    });
+    uint64_t last = edges.empty() ? 0 : sourceOf(edges.back());
+    for (uint64_t w = last + 1; w <= uint64_t(n) + 1; ++w) {
+        offsets[w] = targets.size();
+    }
+
+    BuildStats total;
+    for (const BuildStats &s : stats) {
+        total.duplicates += s.duplicates;
+        total.selfLoops += s.selfLoops;
+    }
+    return total;
+}
+
+// The vertex id widths p1 builds graphs with
+template BuildStats buildCSR<uint16_t>(uint32_t, vector<uint64_t> &, const BuildOptions &, GraphArray<size_t> &,
+                                       GraphArray<uint16_t> &);
+template BuildStats buildCSR<uint32_t>(uint32_t, vector<uint64_t> &, const BuildOptions &, GraphArray<size_t> &,
+                                       GraphArray<uint32_t> &);
+template BuildStats buildCSR<uint64_t>(uint32_t, vector<uint64_t> &, const BuildOptions &, GraphArray<size_t> &,
+                                       GraphArray<uint64_t> &);
@@ -0,0 +1,38 @@
+#ifndef EDGE_BUILDER_HPP
+#define EDGE_BUILDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GraphMemory.hpp"
+
+// Options for building a CSR graph from a raw edge array
+struct BuildOptions {
+    int threads = 1;             // Workers for the sort, the compaction and the offsets
+    bool dropSelfLoops = false;  // Also remove the edges v -> v
+};
+
+// What the builder removed, for --time
+struct BuildStats {
+    size_t duplicates = 0;
+    size_t selfLoops = 0;
+};
+
+// Edge u -> v as one sort key: source in the high half, target in the low half, so
+// sorting the keys sorts by (source, target)
+inline uint64_t packEdge(uint32_t u, uint32_t v) {
+    return (uint64_t(u) << 32) | v;
+}
+
+// Build the CSR form of a graph with 'n' vertices (1-based ids) from 'edges' (packed
+// keys, consumed as scratch space): the keys are radix-sorted by (source, target) on
+// 'threads' workers, repeated edges (and self-loops if asked) are dropped, and
+// offsets (n + 2 entries) and targets are filled so the neighbors of v are
+// targets[offsets[v]] .. targets[offsets[v + 1] - 1], in increasing order. V is the
+// vertex id type of the targets; the keys themselves hold 32-bit ids.
+template <class V>
+BuildStats buildCSR(uint32_t n, std::vector<uint64_t> &edges, const BuildOptions &options,
+                    GraphArray<size_t> &offsets, GraphArray<V> &targets);
+
+#endif
@@ -0,0 +1,490 @@
+#include "ExternalSCC.hpp"
+#include "../common/Trace.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char BINARY_EDGE_MAGIC[8] = {'S', 'C', 'C', 'E', 'D', 'G', 'E', '1'};
+
+namespace {
+
+// One directed edge u -> v as stored on disk
+struct Edge {
+    uint32_t u;
+    uint32_t v;
+};
+
+// Write the whole buffer, retrying on short writes
+void writeAll(int fd, const void *data, size_t bytes) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+        ssize_t written = write(fd, p, bytes);
+        if (written < 0) {
+            throw runtime_error(string("write failed: ") + strerror(errno));
+        }
+        p += written;
+        bytes -= written;
+    }
+}
+
+// Read up to 'bytes', returning fewer only at end of file
+size_t readFull(int fd, void *data, size_t bytes) {
+    char *p = static_cast<char *>(data);
+    size_t total = 0;
+    while (total < bytes) {
+        ssize_t got = read(fd, p + total, bytes - total);
+        if (got < 0) {
+            throw runtime_error(string("read failed: ") + strerror(errno));
+        }
+        if (got == 0) {
+            break;
+        }
+        total += got;
+    }
+    return total;
+}
+
+// An anonymous temporary file holding a partition of the edges. The file is unlinked
+// right after creation, so it disappears with the process even on a crash.
+class SpillFile {
+    int fd;
+    size_t count = 0;  // Number of edges in the file
+
+public:
+    explicit SpillFile(const string &dir) {
+        string pattern = dir + "/sccXXXXXX";
+        vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        fd = mkstemp(path.data());
+        if (fd < 0) {
+            throw runtime_error("cannot create a temporary file in " + dir);
+        }
+        unlink(path.data());
+    }
+
+    ~SpillFile() {
+        close(fd);
+    }
+
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+
+    size_t size() const {
+        return count;
+    }
+
+    // Exchange the contents with another spill file
+    void swap(SpillFile &other) {
+        std::swap(fd, other.fd);
+        std::swap(count, other.count);
+    }
+
+    // Drop the content so the file can be refilled
+    void reset() {
+        if (ftruncate(fd, 0) != 0) {
+            throw runtime_error(string("truncate failed: ") + strerror(errno));
+        }
+        lseek(fd, 0, SEEK_SET);
+        count = 0;
+    }
+
+    // Append a chunk of edges
+    void append(const Edge *edges, size_t n) {
+        writeAll(fd, edges, n * sizeof(Edge));
+        count += n;
+    }
+
+    // Stream the edges through visitChunk(edges, count), 'buffer.size()' edges at a time
+    template <class VisitChunk>
+    void scanChunks(vector<Edge> &buffer, VisitChunk visitChunk) const {
+        lseek(fd, 0, SEEK_SET);
+        size_t left = count;
+        while (left > 0) {
+            size_t chunk = min(left, buffer.size());
+            if (readFull(fd, buffer.data(), chunk * sizeof(Edge)) != chunk * sizeof(Edge)) {
+                throw runtime_error("spill file ended early");
+            }
+            visitChunk(buffer.data(), chunk);
+            left -= chunk;
+        }
+    }
+
+    // Stream every edge through 'visit'
+    template <class Visit>
+    void scan(vector<Edge> &buffer, Visit visit) const {
+        scanChunks(buffer, [&](const Edge *edges, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                visit(edges[i]);
+            }
+        });
+    }
+};
+
+// Buffered appender that flushes into a SpillFile (or a plain descriptor) when full
+class EdgeWriter {
+    vector<Edge> &buffer;
+    size_t used = 0;
+    SpillFile *file;
+    int fd;
+
+public:
+    EdgeWriter(vector<Edge> &buffer, SpillFile &file) : buffer(buffer), file(&file), fd(-1) {}
+    EdgeWriter(vector<Edge> &buffer, int fd) : buffer(buffer), file(nullptr), fd(fd) {}
+
+    void push(Edge e) {
+        buffer[used++] = e;
+        if (used == buffer.size()) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (file) {
+            file->append(buffer.data(), used);
+        } else {
+            writeAll(fd, buffer.data(), used * sizeof(Edge));
+        }
+        used = 0;
+    }
+};
+
+// The whole semi-external computation: O(n) arrays in memory, edges on disk
+class ExternalSCC {
+    static const int LOCAL_ROUNDS = 16;  // Relaxations of one in-memory chunk per scan
+
+    const ExternalOptions &options;
+    uint32_t n = 0;
+    size_t inputEdges = 0;
+
+    vector<Edge> readBuffer;   // Chunk buffer for scans
+    vector<Edge> writeBuffer;  // Chunk buffer for rewrites
+    SpillFile current;         // Edges of the part of the graph still being solved
+    SpillFile next;            // Target of the next rewrite
+
+    vector<uint8_t> alive;     // Vertex not assigned to an SCC yet
+    vector<uint8_t> found;     // Vertex reached by the backward closure this round
+    vector<uint32_t> color;    // Largest vertex id that reaches this vertex
+    vector<uint32_t> inDeg;    // Trimming degrees; reused as list heads when grouping
+    vector<uint32_t> outDeg;   // Trimming degrees; reused as list links when grouping
+    uint32_t aliveCount = 0;
+
+    size_t passes = 0;         // Full scans of the edge partition
+    size_t trimmed = 0;        // Vertices peeled by the trimming stage
+    size_t rounds = 0;         // Coloring rounds
+
+public:
+    explicit ExternalSCC(const ExternalOptions &options)
+        : options(options), current(options.tmpDir), next(options.tmpDir) {}
+
+    void run() {
+        ingest();
+        if (!options.saveBinary.empty()) {
+            return;
+        }
+
+        while (aliveCount > 0) {
+            trim();
+            if (aliveCount == 0) {
+                break;
+            }
+            colorRound();
+        }
+        cout.flush();
+
+        if (options.stats) {
+            cerr << "vertices " << n << " edges " << inputEdges << " trimmed " << trimmed
+                 << " rounds " << rounds << " passes " << passes
+                 << " chunk_edges " << readBuffer.size() << endl;
+        }
+    }
+
+private:
+    // Size the vertex state and split the rest of the memory budget into the two edge buffers
+    void allocate(uint32_t vertices) {
+        n = vertices;
+        size_t stateBytes = (size_t(n) + 1) * (2 * sizeof(uint8_t) + 3 * sizeof(uint32_t));
+        if (stateBytes + 2 * 4096 * sizeof(Edge) > options.memoryLimit) {
+            throw runtime_error("memory limit too small for " + to_string(n) + " vertices (needs at least " +
+                                to_string((stateBytes >> 20) + 1) + " MB)");
+        }
+        size_t chunkEdges = (options.memoryLimit - stateBytes) / (2 * sizeof(Edge));
+        readBuffer.resize(chunkEdges);
+        writeBuffer.resize(chunkEdges);
+
+        alive.assign(n + 1, 1);
+        alive[0] = 0;
+        found.assign(n + 1, 0);
+        color.assign(n + 1, 0);
+        inDeg.assign(n + 1, 0);
+        outDeg.assign(n + 1, 0);
+        aliveCount = n;
+    }
+
+    void checkVertex(long long v) const {
+        if (v < 1 || v > n) {
+            throw runtime_error("vertex " + to_string(v) + " out of range 1.." + to_string(n));
+        }
+    }
+
+    // Stream the input into the first spill file (or the --save-binary target), dropping
+    // self-loops, which never change the SCCs
+    void ingest() {
+        TRACE_SPAN("ingest");
+        int out = -1;
+        uint64_t written = 0;
+        uint64_t header[2] = {0, 0};
+
+        auto openTarget = [&]() {
+            if (options.saveBinary.empty()) {
+                return;
+            }
+            out = open(options.saveBinary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out < 0) {
+                throw runtime_error("cannot create " + options.saveBinary);
+            }
+            writeAll(out, BINARY_EDGE_MAGIC, sizeof(BINARY_EDGE_MAGIC));
+            writeAll(out, header, sizeof(header));  // Patched once the edge count is known
+        };
+
+        auto consume = [&](EdgeWriter &writer, long long u, long long v) {
+            checkVertex(u);
+            checkVertex(v);
+            if (u != v) {
+                writer.push({uint32_t(u), uint32_t(v)});
+                ++written;
+            }
+        };
+
+        if (options.binaryInput) {
+            int in = open(options.input.c_str(), O_RDONLY);
+            if (in < 0) {
+                throw runtime_error("cannot open " + options.input);
+            }
+            char magic[sizeof(BINARY_EDGE_MAGIC)];
+            if (readFull(in, magic, sizeof(magic)) != sizeof(magic) ||
+                memcmp(magic, BINARY_EDGE_MAGIC, sizeof(magic)) != 0 ||
+                readFull(in, header, sizeof(header)) != sizeof(header) || header[0] > UINT32_MAX - 1) {
+                close(in);
+                throw runtime_error(options.input + " is not a binary edge file");
+            }
+            allocate(uint32_t(header[0]));
+            openTarget();
+            EdgeWriter writer = out >= 0 ? EdgeWriter(writeBuffer, out) : EdgeWriter(writeBuffer, current);
+
+            size_t left = header[1];
+            while (left > 0) {
+                size_t chunk = min(left, readBuffer.size());
+                if (readFull(in, readBuffer.data(), chunk * sizeof(Edge)) != chunk * sizeof(Edge)) {
+                    close(in);
+                    throw runtime_error(options.input + " ended early");
+                }
+                for (size_t i = 0; i < chunk; ++i) {
+                    consume(writer, readBuffer[i].u, readBuffer[i].v);
+                }
+                left -= chunk;
+            }
+            writer.flush();
+            inputEdges = header[1];
+            close(in);
+        }
+        else {
+            ifstream file;
+            if (!options.input.empty()) {
+                file.open(options.input);
+                if (!file) {
+                    throw runtime_error("cannot open " + options.input);
+                }
+            }
+            istream &in = options.input.empty() ? cin : file;
+
+            long long vertices, edges;
+            if (!(in >> vertices >> edges) || vertices < 0 || vertices > UINT32_MAX - 1 || edges < 0) {
+                throw runtime_error("expected 'n m' on the first line");
+            }
+            allocate(uint32_t(vertices));
+            openTarget();
+            EdgeWriter writer = out >= 0 ? EdgeWriter(writeBuffer, out) : EdgeWriter(writeBuffer, current);
+
+            for (long long i = 0; i < edges; ++i) {
+                long long u, v;
+                if (!(in >> u >> v)) {
+                    throw runtime_error("expected " + to_string(edges) + " edges");
+                }
+                consume(writer, u, v);
+            }
+            writer.flush();
+            inputEdges = edges;
+        }
+
+        if (out >= 0) {
+            header[0] = n;
+            header[1] = written;
+            if (pwrite(out, header, sizeof(header), sizeof(BINARY_EDGE_MAGIC)) != sizeof(header)) {
+                close(out);
+                throw runtime_error("cannot finish " + options.saveBinary);
+            }
+            close(out);
+        }
+    }
+
+    // Copy the edges matching 'keep' into the spare file and make it current
+    template <class Keep>
+    void rewrite(Keep keep) {
+        next.reset();
+        EdgeWriter writer(writeBuffer, next);
+        ++passes;
+        current.scan(readBuffer, [&](const Edge &e) {
+            if (keep(e)) {
+                writer.push(e);
+            }
+        });
+        writer.flush();
+        current.swap(next);
+    }
+
+    void emitSingleton(uint32_t v) {
+        cout << v << " \n";
+    }
+
+    // Peel vertices without live in- or out-edges; each one is an SCC on its own.
+    // Passes repeat while they still remove a noticeable share of the vertices.
+    void trim() {
+        TRACE_SPAN("trim");
+        size_t removedTotal = 0;
+        while (true) {
+            fill(inDeg.begin(), inDeg.end(), 0);
+            fill(outDeg.begin(), outDeg.end(), 0);
+            ++passes;
+            current.scan(readBuffer, [&](const Edge &e) {
+                if (alive[e.u] && alive[e.v]) {
+                    outDeg[e.u]++;
+                    inDeg[e.v]++;
+                }
+            });
+
+            uint32_t removed = 0;
+            for (uint32_t v = 1; v <= n; ++v) {
+                if (alive[v] && (inDeg[v] == 0 || outDeg[v] == 0)) {
+                    alive[v] = 0;
+                    emitSingleton(v);
+                    ++removed;
+                }
+            }
+            aliveCount -= removed;
+            removedTotal += removed;
+            if (removed == 0 || aliveCount == 0 || removed < aliveCount / 64) {
+                break;
+            }
+        }
+        trimmed += removedTotal;
+
+        if (removedTotal > 0) {
+            rewrite([&](const Edge &e) { return alive[e.u] && alive[e.v]; });
+        }
+    }
+
+    // Apply 'relax' to every edge until no edge changes anything. A chunk that is already
+    // in memory is relaxed repeatedly before the next one is read, which saves most of the
+    // full scans on graphs with long paths.
+    template <class Relax>
+    void propagate(Relax relax) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            ++passes;
+            current.scanChunks(readBuffer, [&](const Edge *edges, size_t count) {
+                for (int local = 0; local < LOCAL_ROUNDS; ++local) {
+                    bool chunkChanged = false;
+                    for (size_t i = 0; i < count; ++i) {
+                        chunkChanged |= relax(edges[i]);
+                    }
+                    if (!chunkChanged) {
+                        break;
+                    }
+                    changed = true;
+                }
+            });
+        }
+    }
+
+    // One coloring round. Forward propagation gives every vertex the largest id that
+    // reaches it; each vertex whose color is its own id is the root of an SCC made of
+    // the same-colored vertices that reach back to it. Those SCCs are emitted and the
+    // edges between different colors are dropped, as they cannot lie inside any SCC.
+    void colorRound() {
+        TRACE_SPAN("color");
+        ++rounds;
+        for (uint32_t v = 1; v <= n; ++v) {
+            color[v] = alive[v] ? v : 0;
+        }
+        propagate([&](const Edge &e) {
+            if (color[e.u] > color[e.v]) {
+                color[e.v] = color[e.u];
+                return true;
+            }
+            return false;
+        });
+
+        for (uint32_t v = 1; v <= n; ++v) {
+            found[v] = alive[v] && color[v] == v;
+        }
+        propagate([&](const Edge &e) {
+            if (found[e.v] && !found[e.u] && color[e.u] == color[e.v]) {
+                found[e.u] = 1;
+                return true;
+            }
+            return false;
+        });
+
+        // Chain the found vertices by color (inDeg holds the heads, outDeg the links)
+        // so every SCC is printed in increasing vertex order without extra memory
+        vector<uint32_t> &head = inDeg;
+        vector<uint32_t> &link = outDeg;
+        fill(head.begin(), head.end(), 0);
+        for (uint32_t v = n; v >= 1; --v) {
+            if (found[v]) {
+                link[v] = head[color[v]];
+                head[color[v]] = v;
+            }
+        }
+        for (uint32_t root = 1; root <= n; ++root) {
+            if (!found[root] || color[root] != root) {
+                continue;
+            }
+            for (uint32_t v = head[root]; v != 0; v = link[v]) {
+                cout << v << " ";
+                alive[v] = 0;
+                --aliveCount;
+            }
+            cout << '\n';
+        }
+
+        rewrite([&](const Edge &e) {
+            return alive[e.u] && alive[e.v] && color[e.u] == color[e.v];
+        });
+    }
+};
+
+}  // namespace
+
+int runExternalSCC(const ExternalOptions &options) {
+    try {
+        ios::sync_with_stdio(false);
+        ExternalSCC scc(options);
+        scc.run();
+    } catch (const exception &e) {
+        cerr << "External SCC failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
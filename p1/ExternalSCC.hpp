@@ -0,0 +1,26 @@
+#ifndef EXTERNAL_SCC_HPP
+#define EXTERNAL_SCC_HPP
+
+#include <cstddef>
+#include <string>
+
+// Options for the out-of-core SCC mode
+struct ExternalOptions {
+    std::string input;                 // Edge file to read, empty reads the text format from stdin
+    bool binaryInput = false;          // The input file uses the binary edge format
+    std::string saveBinary;            // Only convert the input to a binary edge file at this path
+    std::string tmpDir = "/tmp";       // Where the edge partitions are spilled
+    size_t memoryLimit = 256u << 20;   // Upper bound for vertex state plus edge buffers, in bytes
+    bool stats = false;                // Print pass and trimming statistics to stderr
+};
+
+// Binary edge file layout: the 8 magic bytes below, uint64 n, uint64 m, then m pairs
+// of uint32 (u, v) with 1-based vertex ids
+extern const char BINARY_EDGE_MAGIC[8];
+
+// Compute and print the SCCs of a graph whose edges stay on disk. Only O(n) vertex
+// state is kept in memory; the edges are streamed in chunks bounded by the memory
+// limit. Returns the process exit code.
+int runExternalSCC(const ExternalOptions &options);
+
+#endif
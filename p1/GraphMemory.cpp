@@ -0,0 +1,194 @@
+#include "GraphMemory.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char *PAGE_MODE_NAMES[] = {"default", "thp", "hugetlb"};
+const char *NUMA_MODE_NAMES[] = {"off", "interleave"};
+
+namespace {
+
+const size_t HUGE_PAGE = size_t(2) << 20;  // x86-64 huge page; smaller arrays stay on the heap
+const int HUGE_PAGE_SIZE = 21 << MAP_HUGE_SHIFT;  // Asks MAP_HUGETLB for HUGE_PAGE, not the default size
+const int MAX_NODES = 1024;                // Bits in a node mask
+
+MemoryPolicy policy;
+atomic<size_t> mapped_bytes{0};
+atomic<size_t> placed_bytes{0};
+atomic<size_t> hugetlb_fallbacks{0};
+
+size_t roundUp(size_t bytes, size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+// Ids of the online memory nodes, from a list like "0-1,3"
+const vector<int> &onlineNodes() {
+    static const vector<int> nodes = [] {
+        vector<int> found;
+        ifstream in("/sys/devices/system/node/online");
+        string list;
+        if (getline(in, list)) {
+            stringstream ranges(list);
+            string range;
+            while (getline(ranges, range, ',')) {
+                int first = atoi(range.c_str());
+                size_t dash = range.find('-');
+                int last = dash == string::npos ? first : atoi(range.c_str() + dash + 1);
+                for (int node = first; node <= last && node < MAX_NODES; ++node) {
+                    found.push_back(node);
+                }
+            }
+        }
+        if (found.empty()) {
+            found.push_back(0);
+        }
+        return found;
+    }();
+    return nodes;
+}
+
+// Set the NUMA policy of [p, p + bytes); glibc has no wrapper, libnuma's mbind is this call
+bool bindRange(void *p, size_t bytes, int mode, const vector<int> &nodes) {
+    unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+    for (int node : nodes) {
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+    return syscall(SYS_mbind, p, bytes, mode, mask, MAX_NODES + 1, 0) == 0;
+}
+
+// Place a fresh mapping before anything touches it
+void place(char *p, size_t bytes) {
+    const vector<int> &nodes = onlineNodes();
+    if (policy.numa == NumaMode::Off || nodes.size() < 2) {
+        return;
+    }
+    if (bindRange(p, bytes, MPOL_INTERLEAVE, nodes)) {
+        placed_bytes += bytes;
+    }
+}
+
+// Anonymous mapping of 'bytes' (a multiple of HUGE_PAGE) aligned to HUGE_PAGE
+char *mapAligned(size_t bytes) {
+    void *raw = mmap(nullptr, bytes + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    char *start = static_cast<char *>(raw);
+    char *aligned = reinterpret_cast<char *>(roundUp(reinterpret_cast<uintptr_t>(start), HUGE_PAGE));
+    if (aligned > start) {
+        munmap(start, aligned - start);
+    }
+    munmap(aligned + bytes, start + HUGE_PAGE - aligned);
+    return aligned;
+}
+
+// Memory of the whole process backed by huge pages, transparent or explicit, as far as
+// it was touched
+size_t hugeBytes() {
+    ifstream in("/proc/self/smaps_rollup");
+    string line;
+    size_t total = 0;
+    while (getline(in, line)) {
+        size_t colon = line.find(':');
+        string key = line.substr(0, colon);
+        if (key == "AnonHugePages" || key == "Private_Hugetlb" || key == "Shared_Hugetlb") {
+            total += size_t(atol(line.c_str() + colon + 1)) << 10;
+        }
+    }
+    return total;
+}
+
+// Whether arrays of 'bytes' get a mapping of their own under the current policy
+bool isMapped(size_t bytes) {
+    return !policy.isDefault() && bytes >= HUGE_PAGE;
+}
+
+}  // namespace
+
+bool parsePageMode(const string &name, PageMode &mode) {
+    for (int i = 0; i < 3; ++i) {
+        if (name == PAGE_MODE_NAMES[i]) {
+            mode = PageMode(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseNumaMode(const string &name, NumaMode &mode) {
+    for (int i = 0; i < 2; ++i) {
+        if (name == NUMA_MODE_NAMES[i]) {
+            mode = NumaMode(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void setMemoryPolicy(const MemoryPolicy &newPolicy) {
+    policy = newPolicy;
+}
+
+const MemoryPolicy &memoryPolicy() {
+    return policy;
+}
+
+MemoryStats memoryStats() {
+    MemoryStats stats;
+    stats.mappedBytes = mapped_bytes.load();
+    stats.hugeBytes = hugeBytes();
+    stats.placedBytes = placed_bytes.load();
+    stats.fallbacks = hugetlb_fallbacks.load();
+    stats.nodes = onlineNodes().size();
+    return stats;
+}
+
+void *allocateGraphMemory(size_t bytes) {
+    if (!isMapped(bytes)) {
+        return ::operator new(bytes);
+    }
+    size_t length = roundUp(bytes, HUGE_PAGE);
+    char *p = nullptr;
+    if (policy.pages == PageMode::Explicit) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | HUGE_PAGE_SIZE;
+        void *huge = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (huge != MAP_FAILED) {
+            p = static_cast<char *>(huge);
+        }
+        else {
+            hugetlb_fallbacks++;
+        }
+    }
+    if (!p) {
+        p = mapAligned(length);
+        if (!p) {
+            throw bad_alloc();
+        }
+        if (policy.pages != PageMode::Default) {
+            madvise(p, length, MADV_HUGEPAGE);  // Only a hint: THP may be disabled
+        }
+    }
+    place(p, length);
+    mapped_bytes += length;
+    return p;
+}
+
+void freeGraphMemory(void *p, size_t bytes) {
+    if (!isMapped(bytes)) {
+        ::operator delete(p);
+        return;
+    }
+    size_t length = roundUp(bytes, HUGE_PAGE);
+    munmap(p, length);
+    mapped_bytes -= length;
+}
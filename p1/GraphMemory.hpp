@@ -0,0 +1,88 @@
+#ifndef GRAPH_MEMORY_HPP
+#define GRAPH_MEMORY_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Where the large graph arrays (CSR offsets and targets, the transposed CSR, bitset rows,
+// compressed runs) get their memory. By default they come from the heap like any vector.
+// Otherwise every array of at least one huge page is mapped on its own, aligned to a huge
+// page, and placed before the loading thread first touches it:
+//   --pages=thp      asks for transparent huge pages (madvise), fewer TLB misses on adj[v]
+//   --pages=hugetlb  maps explicit huge pages from the reserved 2 MB pool, falling back to
+//                    thp when the pool is empty
+//   --numa=interleave     spreads the pages round robin over all memory nodes, so the
+//                         threads of every stage see the same mix of local and remote
+// NUMA placement calls mbind directly, so no libnuma is needed; on a single node, or where
+// mbind is not permitted, the memory stays where the kernel puts it.
+
+enum class PageMode { Default, Transparent, Explicit };
+enum class NumaMode { Off, Interleave };
+
+extern const char *PAGE_MODE_NAMES[];
+extern const char *NUMA_MODE_NAMES[];
+
+bool parsePageMode(const std::string &name, PageMode &mode);
+bool parseNumaMode(const std::string &name, NumaMode &mode);
+
+struct MemoryPolicy {
+    PageMode pages = PageMode::Default;
+    NumaMode numa = NumaMode::Off;
+
+    bool isDefault() const {
+        return pages == PageMode::Default && numa == NumaMode::Off;
+    }
+};
+
+// Set the policy for the arrays allocated from now on. Call it before the first graph is
+// built: an array is freed the way the policy in force says it was allocated.
+void setMemoryPolicy(const MemoryPolicy &policy);
+const MemoryPolicy &memoryPolicy();
+
+// What the mapped arrays got, for --time
+struct MemoryStats {
+    size_t mappedBytes = 0;    // Held in separately mapped arrays right now
+    size_t hugeBytes = 0;      // Touched memory of the process backed by huge pages
+    size_t placedBytes = 0;    // Mapped with a NUMA policy the kernel accepted
+    size_t fallbacks = 0;      // Explicit huge page mappings the pool could not serve
+    int nodes = 1;             // Online memory nodes
+};
+
+MemoryStats memoryStats();
+
+void *allocateGraphMemory(size_t bytes);
+void freeGraphMemory(void *p, size_t bytes);
+
+// Allocator of the graph arrays; stateless, all instances are interchangeable
+template <class T>
+struct GraphAllocator {
+    typedef T value_type;
+
+    GraphAllocator() = default;
+    template <class U>
+    GraphAllocator(const GraphAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(allocateGraphMemory(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        freeGraphMemory(p, n * sizeof(T));
+    }
+
+    template <class U>
+    bool operator==(const GraphAllocator<U> &) const {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const GraphAllocator<U> &) const {
+        return false;
+    }
+};
+
+template <class T>
+using GraphArray = std::vector<T, GraphAllocator<T>>;
+
+#endif
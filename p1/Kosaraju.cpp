@@ -1,50 +1,82 @@
 #include <iostream>
 #include <vector>
-#include <stack>
 #include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <random>
+#include <fstream>
+#include <cmath>
+
+#include "ExternalSCC.hpp"
+#include "EdgeBuilder.hpp"
+#include "GraphMemory.hpp"
+#include "../common/Trace.hpp"
 
 using namespace std;
 
+template <class V>
 class Graph {
-    int n;  // Number of vertices
-    vector<vector<int>> adj;  // Adjacency list for the original graph
+    V n;  // Number of vertices
+    size_t m = 0;  // Number of edges
+    vector<vector<V>> adj;  // Adjacency list for the original graph
 
 public:
-
-    void printSCCs(const Graph &g);
-    void dfs(const Graph &g, int v, vector<bool> &visited, vector<int> &component);
-    void fillOrder(const Graph &g, int v, vector<bool> &visited, stack<int> &Stack);
-
-
-
-
     // Constructor to initialize the graph with 'n' vertices
-    Graph(int vertices) : n(vertices) {
+    Graph(V vertices) : n(vertices) {
         adj.resize(n + 1);  // Resize adjacency list for 1-based indexing
     }
 
     // Function to add an edge from vertex 'u' to vertex 'v'
-    void addEdge(int u, int v) {
+    void addEdge(V u, V v) {
         adj[u].push_back(v);  // Add edge u -> v in the original graph
+        ++m;
     }
 
     // Get the number of vertices
-    int getNumVertices() const {
+    V getNumVertices() const {
         return n;
     }
 
+    // Get the number of edges
+    size_t getNumEdges() const {
+        return m;
+    }
+
     // Get the adjacency list of the graph
-    const vector<int>& getAdjList(int v) const {
+    const vector<V>& getAdjList(V v) const {
         return adj[v];
     }
 
+    // Bytes held by the adjacency lists
+    size_t memoryBytes() const {
+        size_t bytes = adj.capacity() * sizeof(vector<V>);
+        for (const vector<V> &list : adj) {
+            bytes += list.capacity() * sizeof(V);
+        }
+        return bytes;
+    }
+
     // Function to create and return the transposed graph (reverse edges)
     Graph transposeGraph() const {
         Graph transposed(n);  // Create a new graph with the same number of vertices
         
         // Reverse all edges from the original graph
-        for (int u = 1; u <= n; ++u) {
-            for (int v : adj[u]) {
+        for (V u = 1; u <= n; ++u) {
+            for (V v : adj[u]) {
                 transposed.addEdge(v, u);  // Reverse edge u -> v becomes v -> u
             }
         }
@@ -53,89 +85,1780 @@ public:
     }
 };
 
+// Scratch buffers used by printSCCs. A workspace is sized once per graph and then
+// reused across queries, so repeated SCC computations do not allocate.
+template <class V>
+struct SCCWorkspace {
+    vector<unsigned> mark;          // Epoch-stamped visited set (mark[v] == epoch means visited)
+    unsigned epoch = 0;             // Current visit stamp
+    vector<V> order;                // Vertices in order of completion time (used as a stack)
+    vector<V> component;            // The SCC currently being collected
+    vector<pair<V, size_t>> frames;  // Explicit DFS stack: (vertex, next neighbor index)
+    GraphArray<size_t> tOffsets;    // Transposed graph in CSR form: offsets per vertex
+    GraphArray<V> tTargets;         // Transposed graph in CSR form: concatenated neighbors
+    vector<size_t> inDeg;           // Trimming: live in-degree of every vertex
+    vector<size_t> outDeg;          // Trimming: live out-degree of every vertex
+    vector<unsigned char> removed;  // Trimming: vertex already peeled as a singleton SCC
+    vector<V> trimmed;              // Trimming: peeled vertices in removal order
+
+    // DFS frame over a delta-encoded adjacency run (see CompressedGraph)
+    struct DecodeFrame {
+        V vertex;                   // Vertex whose run is being decoded
+        size_t left;                // Neighbors not decoded yet
+        V last;                     // Last decoded neighbor; the next one is last + delta
+        const unsigned char *pos;   // Next delta to decode
+    };
+    vector<DecodeFrame> decodeFrames;  // Explicit DFS stack for compressed graphs
+
+    // Make sure every buffer can hold a graph with 'n' vertices and 'm' edges
+    void prepare(V n, size_t m) {
+        if (mark.size() < (size_t)n + 1) {
+            mark.assign(n + 1, 0);
+            epoch = 0;
+        }
+        order.reserve(n);
+        component.reserve(n);
+        frames.reserve(n);
+        decodeFrames.reserve(n);
+        tOffsets.resize(n + 2);
+        tTargets.resize(m);
+    }
+
+    // Size the extra buffers used by the trimming stage
+    void prepareTrim(V n) {
+        inDeg.resize(n + 1);
+        outDeg.resize(n + 1);
+        removed.resize(n + 1);
+        trimmed.reserve(n);
+    }
+
+    // Mark every trimmed vertex as visited in the current pass so the DFS skips it
+    void visitTrimmed() {
+        for (V v : trimmed) {
+            visit(v);
+        }
+    }
+
+    // Start a new traversal; all vertices become unvisited in O(1)
+    void newPass() {
+        if (++epoch == 0) {  // The stamp wrapped around, clear the old marks once
+            fill(mark.begin(), mark.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool visited(V v) const {
+        return mark[v] == epoch;
+    }
+
+    void visit(V v) {
+        mark[v] = epoch;
+    }
+};
+
+// Build the transposed graph (reverse edges) into the workspace CSR buffers
+template <class G, class V>
+void transposeInto(const G &g, SCCWorkspace<V> &ws) {
+    V n = g.getNumVertices();
+    fill(ws.tOffsets.begin(), ws.tOffsets.begin() + n + 2, 0);
+
+    // Count the in-degree of every vertex
+    for (V u = 1; u <= n; ++u) {
+        for (V v : g.getAdjList(u)) {
+            ws.tOffsets[v + 1]++;
+        }
+    }
+    for (V v = 1; v <= n + 1; ++v) {
+        ws.tOffsets[v] += ws.tOffsets[v - 1];
+    }
+
+    // Reverse edge u -> v becomes v -> u; scanning u in increasing order keeps
+    // the same neighbor order transposeGraph() produces
+    for (V u = 1; u <= n; ++u) {
+        for (V v : g.getAdjList(u)) {
+            ws.tTargets[ws.tOffsets[v]++] = u;
+        }
+    }
+
+    // The fill loop advanced every offset to the start of the next vertex, shift back
+    for (V v = n + 1; v > 0; --v) {
+        ws.tOffsets[v] = ws.tOffsets[v - 1];
+    }
+    ws.tOffsets[0] = 0;
+}
+
 // Helper function to perform DFS and fill the stack with vertices in order of completion time
-void fillOrder(const Graph &g, int v, vector<bool> &visited, stack<int> &Stack) {
-    visited[v] = true;  // Mark the current vertex as visited
-    
-    // Recur for all adjacent vertices in the original graph
-    for (int i : g.getAdjList(v)) {
-        if (!visited[i]) {
-            fillOrder(g, i, visited, Stack);
+template <class G, class V>
+void fillOrder(const G &g, V start, SCCWorkspace<V> &ws) {
+    ws.visit(start);  // Mark the start vertex as visited
+    ws.frames.emplace_back(start, 0);
+
+    while (!ws.frames.empty()) {
+        V v = ws.frames.back().first;
+        size_t &next = ws.frames.back().second;
+        const auto &adj = g.getAdjList(v);
+
+        // Descend into the next unvisited neighbor in the original graph
+        if (next < adj.size()) {
+            V i = adj[next++];
+            if (!ws.visited(i)) {
+                ws.visit(i);
+                ws.frames.emplace_back(i, 0);
+            }
+            continue;
         }
+
+        // Push the current vertex to the stack after visiting all its neighbors
+        ws.order.push_back(v);
+        ws.frames.pop_back();
     }
-    
-    // Push the current vertex to the stack after visiting all its neighbors
-    Stack.push(v);
 }
 
 // A DFS function to explore all vertices in the reversed graph
-void dfs(const Graph &g, int v, vector<bool> &visited, vector<int> &component) {
-    visited[v] = true;   // Mark the current vertex as visited
-    component.push_back(v);  // Add the current vertex to the current component
+template <class V>
+void dfs(V start, SCCWorkspace<V> &ws) {
+    ws.visit(start);  // Mark the start vertex as visited
+    ws.component.push_back(start);  // Add the start vertex to the current component
+    ws.frames.emplace_back(start, ws.tOffsets[start]);
+
+    while (!ws.frames.empty()) {
+        V v = ws.frames.back().first;
+        size_t &next = ws.frames.back().second;
 
-    // Recur for all adjacent vertices in the reversed graph
-    for (int i : g.getAdjList(v)) {
-        if (!visited[i]) {
-            dfs(g, i, visited, component);
+        // Descend into the next unvisited neighbor in the reversed graph
+        if (next < ws.tOffsets[v + 1]) {
+            V i = ws.tTargets[next++];
+            if (!ws.visited(i)) {
+                ws.visit(i);
+                ws.component.push_back(i);
+                ws.frames.emplace_back(i, ws.tOffsets[i]);
+            }
+            continue;
         }
+        ws.frames.pop_back();
     }
 }
 
-// Function to print the strongly connected components (SCCs) using Kosaraju's algorithm
-void printSCCs(const Graph &g) {
-    int n = g.getNumVertices();
-    stack<int> Stack;
-    vector<bool> visited(n + 1, false);  // Initialize visited array for the first DFS
+// Tuning knobs of the SCC engine
+struct SCCOptions {
+    bool trim = false;    // Peel trivial SCCs before the DFS passes
+    int threads = 1;    // Worker threads for the trimming stage (and the --dedup builder)
+};
+
+// Peel one vertex: lower the live degree of its neighbors and queue the ones that lose
+// their last in- or out-edge. With several workers the degree updates are atomic and
+// the 'removed' flag is claimed with a compare-and-swap, so each vertex is queued once.
+template <class G, class V>
+void peelVertex(const G &g, SCCWorkspace<V> &ws, V v, vector<V> &next, bool atomic) {
+    auto claim = [&](V w) {
+        unsigned char expected = 0;
+        if (!atomic) {
+            ws.removed[w] = 1;
+            return true;
+        }
+        return __atomic_compare_exchange_n(&ws.removed[w], &expected, 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    };
+    auto decrement = [&](size_t &degree) {
+        return atomic ? __atomic_sub_fetch(&degree, 1, __ATOMIC_RELAXED) : --degree;
+    };
+    auto isRemoved = [&](V w) {
+        return atomic ? __atomic_load_n(&ws.removed[w], __ATOMIC_RELAXED) : ws.removed[w];
+    };
+
+    for (V w : g.getAdjList(v)) {
+        if (!isRemoved(w) && decrement(ws.inDeg[w]) == 0 && claim(w)) {
+            next.push_back(w);
+        }
+    }
+    for (size_t i = ws.tOffsets[v]; i < ws.tOffsets[v + 1]; ++i) {
+        V w = ws.tTargets[i];
+        if (!isRemoved(w) && decrement(ws.outDeg[w]) == 0 && claim(w)) {
+            next.push_back(w);
+        }
+    }
+}
+
+// Trimming stage: repeatedly remove vertices with no live in-edge or no live out-edge.
+// Each of them is an SCC on its own; they are collected in ws.trimmed. Needs the
+// transposed graph in the workspace. The worklist is processed level by level so a
+// large level can be split across 'threads' workers.
+template <class G, class V>
+void trimSCCs(const G &g, SCCWorkspace<V> &ws, int threads) {
+    V n = g.getNumVertices();
+    ws.prepareTrim(n);
+    ws.trimmed.clear();
+
+    // The initial degrees come straight from the adjacency sizes
+    size_t head = 0;
+    for (V v = 1; v <= n; ++v) {
+        ws.outDeg[v] = g.getAdjList(v).size();
+        ws.inDeg[v] = ws.tOffsets[v + 1] - ws.tOffsets[v];
+        ws.removed[v] = (ws.inDeg[v] == 0 || ws.outDeg[v] == 0);
+        if (ws.removed[v]) {
+            ws.trimmed.push_back(v);
+        }
+    }
+
+    const size_t PARALLEL_LEVEL = 1 << 14;  // Smaller levels are not worth a thread start
+    while (head < ws.trimmed.size()) {
+        size_t levelEnd = ws.trimmed.size();
+        size_t level = levelEnd - head;
+
+        if (threads <= 1 || level < PARALLEL_LEVEL) {
+            // The worklist grows at its end while the current level is consumed
+            for (; head < levelEnd; ++head) {
+                peelVertex(g, ws, ws.trimmed[head], ws.trimmed, false);
+            }
+            continue;
+        }
+
+        vector<vector<V>> next(threads);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                size_t from = head + level * t / threads;
+                size_t to = head + level * (t + 1) / threads;
+                for (size_t i = from; i < to; ++i) {
+                    peelVertex(g, ws, ws.trimmed[i], next[t], true);
+                }
+            });
+        }
+        for (thread &worker : workers) {
+            worker.join();
+        }
+        head = levelEnd;
+        for (const vector<V> &part : next) {
+            ws.trimmed.insert(ws.trimmed.end(), part.begin(), part.end());
+        }
+    }
+}
+
+// Run Kosaraju's algorithm on 'g' and call emit(component) for every strongly connected component
+template <class G, class V, class Emit>
+void forEachSCC(const G &g, SCCWorkspace<V> &ws, Emit emit, const SCCOptions &options = SCCOptions()) {
+    V n = g.getNumVertices();
+    ws.prepare(n, g.getNumEdges());
+    ws.order.clear();
+    ws.trimmed.clear();
+
+    // Step 0 (optional): Peel the trivial SCCs; only the remaining core goes through the DFS
+    // passes. The transposed graph is built first because trimming needs the in-edges.
+    if (options.trim) {
+        {
+            TRACE_SPAN("transpose");
+            transposeInto(g, ws);
+        }
+        TRACE_SPAN("trim");
+        trimSCCs(g, ws, options.threads);
+        for (V v : ws.trimmed) {
+            ws.component.clear();
+            ws.component.push_back(v);
+            emit(ws.component);
+        }
+    }
 
     // Step 1: Perform DFS on the original graph to fill the stack
-    for (int i = 1; i <= n; ++i) {
-        if (!visited[i]) {
-            fillOrder(g, i, visited, Stack);
+    {
+        TRACE_SPAN("order");
+        ws.newPass();
+        ws.visitTrimmed();
+        for (V i = 1; i <= n; ++i) {
+            if (!ws.visited(i)) {
+                fillOrder(g, i, ws);
+            }
         }
     }
 
     // Step 2: Get the transposed graph
-    Graph transposed = g.transposeGraph();
+    if (!options.trim) {
+        TRACE_SPAN("transpose");
+        transposeInto(g, ws);
+    }
 
-    // Step 3: Reset the visited array for the second DFS
-    fill(visited.begin(), visited.end(), false);
+    // Step 3: Reset the visited set for the second DFS
+    ws.newPass();
+    ws.visitTrimmed();
 
     // Step 4: Process vertices in order of decreasing finishing time (from stack)
-    while (!Stack.empty()) {
-        int v = Stack.top();
-        Stack.pop();
+    TRACE_SPAN("collect");
+    while (!ws.order.empty()) {
+        V v = ws.order.back();
+        ws.order.pop_back();
 
         // If this vertex hasn't been visited, it's part of a new SCC
-        if (!visited[v]) {
-            vector<int> component;  // Stores the current SCC
-            dfs(transposed, v, visited, component);  // Perform DFS on reversed graph for this SCC
+        if (!ws.visited(v)) {
+            ws.component.clear();  // Stores the current SCC
+            dfs(v, ws);  // Perform DFS on reversed graph for this SCC
+            emit(ws.component);
+        }
+    }
+}
+
+// Function to print the strongly connected components (SCCs) using Kosaraju's algorithm
+template <class G, class V>
+void printSCCs(const G &g, SCCWorkspace<V> &ws, const SCCOptions &options = SCCOptions()) {
+    forEachSCC(g, ws, [](const vector<V> &component) {
+        // Print the current strongly connected component
+        for (V vertex : component) {
+            cout << vertex << " ";
+        }
+        cout << '\n';  // Newline after each SCC
+    }, options);
+}
+
+// A contiguous run of neighbors inside a CSR graph
+template <class V>
+struct NeighborRange {
+    const V *first;
+    const V *last;
+
+    const V *begin() const { return first; }
+    const V *end() const { return last; }
+    size_t size() const { return last - first; }
+    V operator[](size_t i) const { return first[i]; }
+};
+
+// Read-only graph in compressed sparse row form: the neighbors of 'v' are
+// targets[offsets[v]] .. targets[offsets[v + 1] - 1]
+template <class V>
+class CSRGraph {
+    V n;  // Number of vertices
+    GraphArray<size_t> offsets;  // Start of every adjacency run (n + 2 entries, 1-based)
+    GraphArray<V> targets;  // All adjacency runs back to back
 
-            // Print the current strongly connected component
-            for (int vertex : component) {
-                cout << vertex << " ";
+public:
+    CSRGraph() : n(0) {}
+
+    // Take over arrays in the layout buildCSR produces
+    CSRGraph(V n, GraphArray<size_t> offsets, GraphArray<V> targets)
+        : n(n), offsets(move(offsets)), targets(move(targets)) {}
+
+    // Copy 'g' into CSR form, renaming every vertex 'v' to newId[v] and sorting each
+    // adjacency run so neighbors are visited in memory order
+    template <class G>
+    CSRGraph(const G &g, const vector<V> &newId) : n(g.getNumVertices()) {
+        offsets.assign(n + 2, 0);
+        targets.resize(g.getNumEdges());
+
+        for (V u = 1; u <= n; ++u) {
+            offsets[newId[u] + 1] = g.getAdjList(u).size();
+        }
+        for (V v = 1; v <= n + 1; ++v) {
+            offsets[v] += offsets[v - 1];
+        }
+        for (V u = 1; u <= n; ++u) {
+            size_t pos = offsets[newId[u]];
+            for (V v : g.getAdjList(u)) {
+                targets[pos++] = newId[v];
             }
-            cout << endl;  // Newline after each SCC
+            sort(targets.begin() + offsets[newId[u]], targets.begin() + pos);
         }
     }
+
+    // Rebuild from the edges (u, v) stored back to back in 'edges'. Every adjacency run
+    // keeps the input order, like Graph, and the buffers are reused: a CSRGraph kept per
+    // thread stops allocating once it held its largest graph.
+    template <class E>
+    void assign(V vertices, const vector<E> &edges) {
+        n = vertices;
+        size_t m = edges.size() / 2;
+        offsets.assign(n + 2, 0);
+        targets.resize(m);
+        for (size_t i = 0; i < m; ++i) {
+            offsets[edges[2 * i] + 1]++;
+        }
+        for (V v = 1; v <= n + 1; ++v) {
+            offsets[v] += offsets[v - 1];
+        }
+        for (size_t i = 0; i < m; ++i) {
+            targets[offsets[edges[2 * i]]++] = edges[2 * i + 1];
+        }
+
+        // The fill loop advanced every offset to the start of the next vertex, shift back
+        for (V v = n + 1; v > 0; --v) {
+            offsets[v] = offsets[v - 1];
+        }
+        offsets[0] = 0;
+    }
+
+    // Get the number of vertices
+    V getNumVertices() const {
+        return n;
+    }
+
+    // Get the number of edges
+    size_t getNumEdges() const {
+        return targets.size();
+    }
+
+    // Get the adjacency list of the graph
+    NeighborRange<V> getAdjList(V v) const {
+        return {targets.data() + offsets[v], targets.data() + offsets[v + 1]};
+    }
+
+    // Bytes held by the offsets and targets
+    size_t memoryBytes() const {
+        return offsets.size() * sizeof(size_t) + targets.size() * sizeof(V);
+    }
+};
+
+// Append 'value' as a LEB128 varint: 7 bits per byte, high bit set on all but the last byte
+void putVarint(GraphArray<unsigned char> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
 }
 
-int main() {
-    int n, m;
-    
-    // Input: Read the number of vertices (n) and edges (m)
-    cin >> n >> m;
+// Decode one varint starting at 'p' and advance 'p' past it
+inline uint64_t getVarint(const unsigned char *&p) {
+    uint64_t value = *p & 0x7f;
+    for (int shift = 7; *p++ & 0x80; shift += 7) {
+        value |= uint64_t(*p & 0x7f) << shift;
+    }
+    return value;
+}
 
-    Graph g(n);  // Create a graph with 'n' vertices
+// Neighbors of one vertex in a CompressedGraph, decoded while iterating
+template <class V>
+class CompressedRange {
+    const unsigned char *data;  // First delta of the run
+    size_t count;  // Number of neighbors
 
-    // Input: Read the 'm' edges
-    for (int i = 0; i < m; ++i) {
-        int u, v;
-        cin >> u >> v;  // Read edge from vertex u to vertex v
-        g.addEdge(u, v);  // Add the edge to the graph
+public:
+    class iterator {
+        const unsigned char *p;
+        size_t left;
+        V value;
+
+    public:
+        iterator(const unsigned char *p, size_t left) : p(p), left(left), value(0) {
+            if (left > 0) {
+                value = getVarint(this->p);
+            }
+        }
+        V operator*() const { return value; }
+        iterator &operator++() {
+            if (--left > 0) {
+                value += getVarint(p);
+            }
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return left != other.left; }
+    };
+
+    CompressedRange(const unsigned char *data, size_t count) : data(data), count(count) {}
+
+    iterator begin() const { return iterator(data, count); }
+    iterator end() const { return iterator(nullptr, 0); }
+    size_t size() const { return count; }
+};
+
+// Edges of a graph in input order, kept as a byte log while they are read: every edge is
+// two zigzag varints, its source and its target minus those of the previous edge, so an
+// input listed by source takes a few bytes per edge instead of an adjacency list entry
+// plus 24 bytes of vector per vertex. CompressedGraph is encoded from it.
+template <class V>
+class EdgeLog {
+    V n;  // Number of vertices
+    size_t m = 0;  // Number of edges
+    uint64_t lastSource = 0, lastTarget = 0;
+    GraphArray<unsigned char> bytes;
+    vector<size_t> degrees;  // Out-degree of every vertex (1-based)
+
+    static uint64_t zigzag(uint64_t delta) {
+        return (delta << 1) ^ (0 - (delta >> 63));
+    }
+
+    static uint64_t unzigzag(uint64_t value) {
+        return (value >> 1) ^ (0 - (value & 1));
+    }
+
+public:
+    explicit EdgeLog(V vertices) : n(vertices), degrees(size_t(vertices) + 1, 0) {}
+
+    // Append the edge u -> v
+    void addEdge(V u, V v) {
+        putVarint(bytes, zigzag(uint64_t(u) - lastSource));
+        putVarint(bytes, zigzag(uint64_t(v) - lastTarget));
+        lastSource = u;
+        lastTarget = v;
+        degrees[u]++;
+        ++m;
+    }
+
+    // Call f(u, v) for every edge in input order
+    template <class F>
+    void forEach(F f) const {
+        const unsigned char *p = bytes.data();
+        const unsigned char *end = p + bytes.size();
+        uint64_t u = 0, v = 0;
+        while (p < end) {
+            u += unzigzag(getVarint(p));
+            v += unzigzag(getVarint(p));
+            f(V(u), V(v));
+        }
+    }
+
+    V getNumVertices() const {
+        return n;
+    }
+
+    size_t getNumEdges() const {
+        return m;
+    }
+
+    size_t getDegree(V v) const {
+        return degrees[v];
+    }
+
+    // Bytes held by the log itself
+    size_t logBytes() const {
+        return bytes.size();
+    }
+
+    // Release the log and the degrees
+    void clear() {
+        GraphArray<unsigned char>().swap(bytes);
+        vector<size_t>().swap(degrees);
+    }
+};
+
+// Read-only graph whose adjacency runs are sorted and stored as delta-encoded varints:
+// every run is "degree, first neighbor, gap, gap, ...". Small gaps (sorted lists, local
+// vertex ids) take a single byte instead of four, and the DFS decodes them on the fly.
+template <class V>
+class CompressedGraph {
+    static const int BLOCK = 64;  // Vertices sharing one absolute byte offset
+
+    V n;  // Number of vertices
+    size_t m;  // Number of edges
+    vector<size_t> blockOffsets;  // Byte offset of the first run of every block of vertices
+    vector<uint32_t> offsets;  // Byte offset of every run relative to its block (1-based)
+    GraphArray<unsigned char> bytes;  // All runs back to back
+
+    const unsigned char *run(V v) const {
+        return bytes.data() + blockOffsets[v / BLOCK] + offsets[v];
+    }
+
+    void reset(size_t expectedBytes) {
+        offsets.assign(n + 1, 0);
+        blockOffsets.assign(n / BLOCK + 1, 0);
+        bytes.reserve(expectedBytes);
+    }
+
+    // Sort the neighbors first .. last - 1 of 'u', the vertex after the last one encoded,
+    // and append its run
+    void appendRun(V u, V *first, V *last) {
+        if (u % BLOCK == 0) {
+            blockOffsets[u / BLOCK] = bytes.size();
+        }
+        if (bytes.size() - blockOffsets[u / BLOCK] > UINT32_MAX) {
+            throw length_error("adjacency block larger than 4 GB");
+        }
+        offsets[u] = bytes.size() - blockOffsets[u / BLOCK];
+        sort(first, last);
+
+        putVarint(bytes, last - first);
+        V previous = 0;
+        for (V *p = first; p != last; ++p) {
+            putVarint(bytes, *p - previous);
+            previous = *p;
+        }
+    }
+
+public:
+    // Encode 'g' with every vertex 'v' renamed to newId[v]
+    template <class G>
+    CompressedGraph(const G &g, const vector<V> &newId) : n(g.getNumVertices()), m(g.getNumEdges()) {
+        vector<V> oldId(n + 1, 0);
+        for (V u = 1; u <= n; ++u) {
+            oldId[newId[u]] = u;
+        }
+
+        reset(m + 2 * (size_t)n);
+        vector<V> run;
+        for (V u = 1; u <= n; ++u) {
+            run.clear();
+            for (V v : g.getAdjList(oldId[u])) {
+                run.push_back(newId[v]);
+            }
+            appendRun(u, run.data(), run.data() + run.size());
+        }
+        bytes.shrink_to_fit();
+    }
+
+    // Encode the edges of 'log' and release it. The sources are taken in slices of about
+    // an eighth of the edges: the targets of a slice are gathered from the log, sorted
+    // and encoded, so besides the log and the result only one slice is ever held.
+    explicit CompressedGraph(EdgeLog<V> &log) : n(log.getNumVertices()), m(log.getNumEdges()) {
+        reset(log.logBytes() + n);
+        size_t sliceEdges = max(m / 8, size_t(1) << 20);
+        vector<size_t> start, next;
+        vector<V> targets;
+        for (V first = 1; first <= n;) {
+            V last = first;
+            size_t edges = 0;
+            while (last <= n && (last == first || edges + log.getDegree(last) <= sliceEdges)) {
+                edges += log.getDegree(last++);
+            }
+
+            start.assign(last - first + 1, 0);
+            for (V u = first; u < last; ++u) {
+                start[u - first + 1] = start[u - first] + log.getDegree(u);
+            }
+            next.assign(start.begin(), start.end() - 1);
+            targets.resize(edges);
+            log.forEach([&](V u, V v) {
+                if (u >= first && u < last) {
+                    targets[next[u - first]++] = v;
+                }
+            });
+            for (V u = first; u < last; ++u) {
+                appendRun(u, targets.data() + start[u - first], targets.data() + start[u - first + 1]);
+            }
+            first = last;
+        }
+        log.clear();
+        bytes.shrink_to_fit();
+    }
+
+    // Get the number of vertices
+    V getNumVertices() const {
+        return n;
+    }
+
+    // Get the number of edges
+    size_t getNumEdges() const {
+        return m;
+    }
+
+    // Get the adjacency list of the graph
+    CompressedRange<V> getAdjList(V v) const {
+        const unsigned char *p = run(v);
+        size_t degree = getVarint(p);
+        return CompressedRange<V>(p, degree);
+    }
+
+    // Start decoding the run of 'v': returns the first delta and sets 'degree'
+    const unsigned char *runStart(V v, size_t &degree) const {
+        const unsigned char *p = run(v);
+        degree = getVarint(p);
+        return p;
+    }
+
+    // Bytes held by the offsets and the encoded runs
+    size_t memoryBytes() const {
+        return blockOffsets.size() * sizeof(size_t) + offsets.size() * sizeof(uint32_t) + bytes.size();
+    }
+};
+
+// fillOrder for the compressed graph: every DFS frame keeps a decode cursor (byte
+// position, neighbors left, last decoded neighbor) instead of a neighbor index
+template <class V>
+void fillOrder(const CompressedGraph<V> &g, V start, SCCWorkspace<V> &ws) {
+    auto push = [&](V v) {
+        ws.visit(v);
+        size_t degree;
+        const unsigned char *p = g.runStart(v, degree);
+        ws.decodeFrames.push_back({v, degree, 0, p});
+    };
+    push(start);
+
+    while (!ws.decodeFrames.empty()) {
+        typename SCCWorkspace<V>::DecodeFrame &frame = ws.decodeFrames.back();
+
+        // Descend into the next unvisited neighbor in the original graph
+        if (frame.left > 0) {
+            frame.left--;
+            frame.last += V(getVarint(frame.pos));
+            if (!ws.visited(frame.last)) {
+                push(frame.last);
+            }
+            continue;
+        }
+
+        // Push the current vertex to the stack after visiting all its neighbors
+        ws.order.push_back(frame.vertex);
+        ws.decodeFrames.pop_back();
+    }
+}
+
+// Set bits of one row of a BitsetGraph, i.e. the neighbors of one vertex in order
+template <class V>
+class BitsetRange {
+    const uint64_t *row;
+    size_t words;
+
+public:
+    class iterator {
+        const uint64_t *row;
+        size_t words;
+        size_t word;        // Word holding the current bit
+        uint64_t pending;   // Bits of that word not returned yet, the current one included
+
+        // Move to the next word with a bit left; the end is (words, 0)
+        void skipEmpty() {
+            while (pending == 0 && word < words) {
+                if (++word < words) {
+                    pending = row[word];
+                }
+            }
+        }
+
+    public:
+        iterator(const uint64_t *row, size_t words, size_t word)
+            : row(row), words(words), word(word), pending(word < words ? row[word] : 0) {
+            skipEmpty();
+        }
+        V operator*() const { return V(word * 64 + __builtin_ctzll(pending)); }
+        iterator &operator++() {
+            pending &= pending - 1;
+            skipEmpty();
+            return *this;
+        }
+        bool operator!=(const iterator &other) const { return word != other.word || pending != other.pending; }
+    };
+
+    BitsetRange(const uint64_t *row, size_t words) : row(row), words(words) {}
+
+    iterator begin() const { return iterator(row, words, 0); }
+    iterator end() const { return iterator(row, words, words); }
+    size_t size() const {
+        size_t count = 0;
+        for (size_t w = 0; w < words; ++w) {
+            count += __builtin_popcountll(row[w]);
+        }
+        return count;
+    }
+};
+
+// Read-only graph as an adjacency matrix, one bit per (u, v): row u holds the
+// out-neighbors of u. It takes n^2 / 8 bytes whatever m is, so it only pays on dense
+// graphs, where scanning a row word by word beats chasing m neighbor ids. Repeated
+// edges collapse into one bit.
+template <class V>
+class BitsetGraph {
+    V n;  // Number of vertices
+    size_t m = 0;  // Number of distinct edges
+    size_t words;  // 64-bit words per row (ids 0 .. n)
+    GraphArray<uint64_t> bits;  // All rows back to back
+
+public:
+    // Build the matrix of 'g' with every vertex 'v' renamed to newId[v]
+    template <class G>
+    BitsetGraph(const G &g, const vector<V> &newId)
+        : n(g.getNumVertices()), words((size_t(n) + 64) / 64), bits((size_t(n) + 1) * words, 0) {
+        for (V u = 1; u <= n; ++u) {
+            uint64_t *row = &bits[size_t(newId[u]) * words];
+            for (V v : g.getAdjList(u)) {
+                uint64_t bit = uint64_t(1) << (newId[v] % 64);
+                m += !(row[newId[v] / 64] & bit);
+                row[newId[v] / 64] |= bit;
+            }
+        }
+    }
+
+    // Get the number of vertices
+    V getNumVertices() const {
+        return n;
+    }
+
+    // Get the number of edges
+    size_t getNumEdges() const {
+        return m;
+    }
+
+    // Get the adjacency list of the graph
+    BitsetRange<V> getAdjList(V v) const {
+        return BitsetRange<V>(&bits[size_t(v) * words], words);
+    }
+
+    // First neighbor of 'v' with an id of at least 'from', or 0 when there is none
+    V nextNeighbor(V v, size_t from) const {
+        const uint64_t *row = &bits[size_t(v) * words];
+        size_t w = from / 64;
+        if (w >= words) {
+            return 0;
+        }
+        uint64_t pending = row[w] & (~uint64_t(0) << (from % 64));
+        while (pending == 0) {
+            if (++w == words) {
+                return 0;
+            }
+            pending = row[w];
+        }
+        return V(w * 64 + __builtin_ctzll(pending));
+    }
+
+    // Bytes held by the matrix
+    size_t memoryBytes() const {
+        return bits.size() * sizeof(uint64_t);
+    }
+};
+
+// fillOrder for the bitset graph: a DFS frame keeps the id to resume the row scan at
+// instead of a neighbor index
+template <class V>
+void fillOrder(const BitsetGraph<V> &g, V start, SCCWorkspace<V> &ws) {
+    ws.visit(start);  // Mark the start vertex as visited
+    ws.frames.emplace_back(start, 1);
+
+    while (!ws.frames.empty()) {
+        V v = ws.frames.back().first;
+        size_t &next = ws.frames.back().second;
+
+        // Descend into the next unvisited neighbor in the original graph
+        V i = g.nextNeighbor(v, next);
+        if (i != 0) {
+            next = size_t(i) + 1;
+            if (!ws.visited(i)) {
+                ws.visit(i);
+                ws.frames.emplace_back(i, 1);
+            }
+            continue;
+        }
+
+        // Push the current vertex to the stack after visiting all its neighbors
+        ws.order.push_back(v);
+        ws.frames.pop_back();
+    }
+}
+
+// Vertex relabeling strategies applied before the SCC engine runs
+enum class Reorder { None, BFS, RCM, Degree };
+
+// Build the undirected view (out-neighbors followed by in-neighbors) used by the reorderings
+template <class G, class V>
+void undirectedNeighbors(const G &g, vector<size_t> &offsets, vector<V> &targets) {
+    V n = g.getNumVertices();
+    offsets.assign(n + 2, 0);
+    for (V u = 1; u <= n; ++u) {
+        offsets[u + 1] += g.getAdjList(u).size();
+        for (V v : g.getAdjList(u)) {
+            offsets[v + 1]++;
+        }
+    }
+    for (V v = 1; v <= n + 1; ++v) {
+        offsets[v] += offsets[v - 1];
+    }
+
+    targets.resize(offsets[n + 1]);
+    vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (V u = 1; u <= n; ++u) {
+        for (V v : g.getAdjList(u)) {
+            targets[pos[u]++] = v;
+            targets[pos[v]++] = u;
+        }
+    }
+}
+
+// Compute newId[v] for every vertex of 'g' according to 'mode'. New ids are 1-based as well.
+template <class V, class G>
+vector<V> computeOrdering(const G &g, Reorder mode) {
+    V n = g.getNumVertices();
+    vector<size_t> offsets;
+    vector<V> targets;
+    undirectedNeighbors(g, offsets, targets);
+
+    auto degree = [&](V v) { return offsets[v + 1] - offsets[v]; };
+    vector<V> sequence;  // Vertices in their new order
+    sequence.reserve(n);
+
+    if (mode == Reorder::Degree) {
+        // Hubs first: the most frequently touched vertices share cache lines
+        for (V v = 1; v <= n; ++v) {
+            sequence.push_back(v);
+        }
+        stable_sort(sequence.begin(), sequence.end(), [&](V a, V b) {
+            return degree(a) > degree(b);
+        });
+    }
+    else {
+        // BFS over the undirected view, one tree per connected piece. RCM starts every
+        // piece at its lowest-degree vertex, visits neighbors by increasing degree and
+        // reverses the final sequence (reverse Cuthill-McKee).
+        vector<V> starts;
+        for (V v = 1; v <= n; ++v) {
+            starts.push_back(v);
+        }
+        if (mode == Reorder::RCM) {
+            stable_sort(starts.begin(), starts.end(), [&](V a, V b) {
+                return degree(a) < degree(b);
+            });
+        }
+
+        vector<bool> queued(n + 1, false);
+        vector<V> neighbors;
+        for (V s : starts) {
+            if (queued[s]) {
+                continue;
+            }
+            queued[s] = true;
+            size_t head = sequence.size();
+            sequence.push_back(s);
+
+            while (head < sequence.size()) {
+                V v = sequence[head++];
+                neighbors.clear();
+                for (size_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+                    if (!queued[targets[i]]) {
+                        queued[targets[i]] = true;
+                        neighbors.push_back(targets[i]);
+                    }
+                }
+                if (mode == Reorder::RCM) {
+                    stable_sort(neighbors.begin(), neighbors.end(), [&](V a, V b) {
+                        return degree(a) < degree(b);
+                    });
+                }
+                sequence.insert(sequence.end(), neighbors.begin(), neighbors.end());
+            }
+        }
+        if (mode == Reorder::RCM) {
+            reverse(sequence.begin(), sequence.end());
+        }
+    }
+
+    vector<V> newId(n + 1, 0);
+    for (V i = 0; i < n; ++i) {
+        newId[sequence[i]] = i + 1;
+    }
+    return newId;
+}
+
+// Run the SCC engine on a relabeled graph (CSR or compressed) and print the components
+// using the original vertex ids (originalId[newId] == old id)
+template <class G, class V>
+void printSCCsReordered(const G &relabeled, const vector<V> &originalId, SCCWorkspace<V> &ws,
+                        const SCCOptions &options) {
+    forEachSCC(relabeled, ws, [&](const vector<V> &component) {
+        for (V vertex : component) {
+            cout << originalId[vertex] << " ";
+        }
+        cout << '\n';  // Newline after each SCC
+    }, options);
+}
+
+// Reads whitespace-separated integers from a file through a large buffer, much cheaper
+// than cin on the many small graphs of batch mode
+class IntScanner {
+    FILE *file;
+    vector<char> buffer;
+    size_t pos = 0, len = 0;
+    bool malformed = false;
+
+    bool fill() {
+        pos = 0;
+        len = fread(buffer.data(), 1, buffer.size(), file);
+        return len > 0;
+    }
+
+public:
+    explicit IntScanner(FILE *file) : file(file), buffer(1 << 20) {}
+
+    // Read the next integer; returns false at the end of the file or at a token that is
+    // not a number
+    bool next(long &value) {
+        while (true) {
+            if (pos == len && !fill()) {
+                return false;
+            }
+            if (!isspace((unsigned char)buffer[pos])) {
+                break;
+            }
+            ++pos;
+        }
+        bool negative = buffer[pos] == '-';
+        if (negative) {
+            ++pos;
+        }
+        value = 0;
+        int digits = 0;
+        while ((pos < len || fill()) && isdigit((unsigned char)buffer[pos]) && digits < 18) {
+            value = value * 10 + (buffer[pos++] - '0');
+            ++digits;
+        }
+        if (digits == 0 || (pos < len && !isspace((unsigned char)buffer[pos]))) {
+            malformed = true;
+            return false;
+        }
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    // Whether reading stopped at a token that is not a number
+    bool failed() const {
+        return malformed;
+    }
+};
+
+// Append 'value' in decimal, without the temporary string of to_string
+void appendInt(string &out, uint64_t value) {
+    char digits[20];
+    int len = 0;
+    do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (len > 0) {
+        out += digits[--len];
+    }
+}
+
+// One graph of a batch, numbered in input order
+struct BatchJob {
+    size_t index;
+    int n;
+    vector<uint32_t> edges;  // (u, v) pairs back to back
+};
+
+// Batch mode: compute the SCCs of every graph in the inputs ("n m" followed by m edges,
+// any number of graphs per file; stdin when 'inputs' is empty). The main thread parses,
+// 'jobs' workers each keep one CSRGraph and one workspace for all the graphs they get,
+// and a writer thread prints every graph's components, then an empty line, in input
+// order. At most a window of graphs is in flight, so memory stays bounded on an
+// endless stream. Returns the process exit code.
+int runBatch(const vector<string> &inputs, int jobs, const SCCOptions &options, bool timing) {
+    auto start = chrono::steady_clock::now();
+    mutex lock;
+    condition_variable jobReady, resultReady, windowOpen;
+    deque<BatchJob> pending;      // Parsed graphs waiting for a worker
+    map<size_t, string> results;  // Finished graphs waiting for their turn to be written
+    size_t parsed = 0;            // Graphs handed to the workers
+    size_t written = 0;           // Graphs written out
+    bool inputDone = false;
+    const size_t window = 8 * (size_t)jobs;
+
+    vector<thread> workers;
+    for (int t = 0; t < jobs; ++t) {
+        workers.emplace_back([&]() {
+            // One graph and workspace per vertex id width; most batch graphs are small
+            CSRGraph<uint16_t> small;
+            SCCWorkspace<uint16_t> smallWs;
+            CSRGraph<uint32_t> large;
+            SCCWorkspace<uint32_t> largeWs;
+            BatchJob job;
+            string text;
+            auto solve = [&](auto &g, auto &ws) {
+                g.assign(job.n, job.edges);
+                forEachSCC(g, ws, [&](const auto &component) {
+                    for (auto vertex : component) {
+                        appendInt(text, vertex);
+                        text += ' ';
+                    }
+                    text += '\n';
+                }, options);
+            };
+            while (true) {
+                {
+                    unique_lock<mutex> guard(lock);
+                    jobReady.wait(guard, [&] { return !pending.empty() || inputDone; });
+                    if (pending.empty()) {
+                        return;
+                    }
+                    job = move(pending.front());
+                    pending.pop_front();
+                }
+                text.clear();
+                if (job.n + 2 <= UINT16_MAX) {
+                    solve(small, smallWs);
+                } else {
+                    solve(large, largeWs);
+                }
+                text += '\n';  // An empty line ends the graph
+                lock_guard<mutex> guard(lock);
+                results[job.index] = move(text);
+                resultReady.notify_one();
+            }
+        });
+    }
+
+    thread writer([&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            resultReady.wait(guard, [&] { return results.count(written) || (inputDone && written == parsed); });
+            auto it = results.find(written);
+            if (it == results.end()) {
+                return;  // Every graph was written
+            }
+            string text = move(it->second);
+            results.erase(it);
+            guard.unlock();
+            fwrite(text.data(), 1, text.size(), stdout);
+            guard.lock();
+            ++written;
+            windowOpen.notify_one();
+        }
+    });
+
+    // Parse the graphs one after the other; a malformed graph ends the batch
+    string error;
+    vector<FILE *> files;
+    if (inputs.empty()) {
+        files.push_back(stdin);
+    }
+    for (const string &path : inputs) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file) {
+            error = "cannot open " + path + ": " + strerror(errno);
+            break;
+        }
+        files.push_back(file);
+    }
+    for (size_t f = 0; f < files.size() && error.empty(); ++f) {
+        IntScanner in(files[f]);
+        long n, m;
+        while (error.empty() && in.next(n)) {
+            BatchJob job;
+            job.index = parsed;
+            job.n = n;
+            if (!in.next(m) || n < 0 || m < 0 || n > INT32_MAX) {
+                error = "bad header";
+                break;
+            }
+            // The edges are stored as they arrive: m is unchecked, a header promising
+            // more edges than follow must not allocate for all of them up front
+            job.edges.reserve(2 * min(m, 1L << 20));
+            for (long i = 0; i < 2 * m; ++i) {
+                long v;
+                if (!in.next(v) || v < 1 || v > n) {
+                    error = "bad edge " + to_string(i / 2 + 1);
+                    break;
+                }
+                job.edges.push_back(v);
+            }
+            if (!error.empty()) {
+                break;
+            }
+
+            unique_lock<mutex> guard(lock);
+            windowOpen.wait(guard, [&] { return parsed - written < window; });
+            pending.push_back(move(job));
+            ++parsed;
+            jobReady.notify_one();
+        }
+        if (error.empty() && in.failed()) {
+            error = "bad number";
+        }
+        if (!error.empty()) {
+            error = "graph " + to_string(parsed + 1) + " of " + (inputs.empty() ? "stdin" : inputs[f]) + ": " + error;
+        }
+    }
+    for (FILE *file : files) {
+        if (file != stdin) {
+            fclose(file);
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        inputDone = true;
+    }
+    jobReady.notify_all();
+    resultReady.notify_one();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    writer.join();
+    fflush(stdout);
+
+    if (!error.empty()) {
+        cerr << "Batch stopped at " << error << endl;
+        return 1;
+    }
+    if (timing) {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cerr << "graphs " << parsed << " jobs " << jobs << " batch_ms " << ms << " graphs_per_s "
+             << (ms > 0 ? uint64_t(parsed * 1000 / ms) : 0) << endl;
+    }
+    return 0;
+}
+
+// The files of 'dir' in name order, for --batch-dir
+bool listBatchDir(const string &dir, vector<string> &files) {
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        cerr << "Cannot open " << dir << ": " << strerror(errno) << endl;
+        return false;
+    }
+    while (dirent *entry = readdir(d)) {
+        if (entry->d_name[0] != '.') {
+            files.push_back(dir + "/" + entry->d_name);
+        }
+    }
+    closedir(d);
+    sort(files.begin(), files.end());
+    return true;
+}
+
+// Milliseconds elapsed since 'start', used by --time
+double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Largest resident set of the process so far, loading and preprocessing included
+size_t peakRssBytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return size_t(usage.ru_maxrss) * 1024;
+}
+
+// Parse the value of the --reorder flag
+bool parseReorder(const string &name, Reorder &mode) {
+    if (name == "none") mode = Reorder::None;
+    else if (name == "bfs") mode = Reorder::BFS;
+    else if (name == "rcm") mode = Reorder::RCM;
+    else if (name == "degree") mode = Reorder::Degree;
+    else return false;
+    return true;
+}
+
+// Graph layouts the SCC engine can traverse
+enum class Backend {
+    List,        // The adjacency lists as loaded
+    CSR,         // One flat array of neighbors, sorted per vertex
+    Bitset,      // Adjacency matrix, one bit per vertex pair
+    Compressed,  // CSR with delta + varint encoded neighbors
+    Auto         // Pick one of the above from n and m (see chooseBackend)
+};
+
+const char *BACKEND_NAMES[] = {"list", "csr", "bitset", "compressed", "auto"};
+
+// Parse the value of the --backend flag
+bool parseBackend(const string &name, Backend &backend) {
+    for (int b = 0; b <= (int)Backend::Auto; ++b) {
+        if (name == BACKEND_NAMES[b]) {
+            backend = Backend(b);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Crossover points of the automatic choice, measured on the host by --calibrate. The
+// defaults are what a typical machine measures.
+struct Calibration {
+    double denseDensity = 0.125;            // m / n^2 from which the bitset beats CSR
+    uint64_t compressedEdges = UINT64_MAX;  // Edges from which compressed CSR beats CSR
+};
+
+// Where the calibration is kept between runs: --calibration=FILE, else ~/.p1_calibration
+string defaultCalibrationPath() {
+    const char *home = getenv("HOME");
+    return string(home ? home : ".") + "/.p1_calibration";
+}
+
+// Read "dense_density X" and "compressed_edges Y" lines ("never" for no crossover).
+// A missing file leaves the defaults.
+Calibration loadCalibration(const string &path) {
+    Calibration calibration;
+    ifstream in(path);
+    string key, value;
+    while (in >> key >> value) {
+        if (key == "dense_density") {
+            calibration.denseDensity = value == "never" ? HUGE_VAL : atof(value.c_str());
+        } else if (key == "compressed_edges") {
+            calibration.compressedEdges = value == "never" ? UINT64_MAX : strtoull(value.c_str(), nullptr, 10);
+        }
+    }
+    return calibration;
+}
+
+bool saveCalibration(const string &path, const Calibration &calibration) {
+    ofstream out(path);
+    out << "dense_density ";
+    if (std::isinf(calibration.denseDensity)) {
+        out << "never\n";
+    } else {
+        out << calibration.denseDensity << "\n";
+    }
+    out << "compressed_edges ";
+    if (calibration.compressedEdges == UINT64_MAX) {
+        out << "never\n";
+    } else {
+        out << calibration.compressedEdges << "\n";
+    }
+    return bool(out);
+}
+
+// The layout for a graph with 'n' vertices and 'm' edges: the matrix once the graph is
+// dense enough, the compressed CSR once it is large enough to be bound by memory
+// bandwidth, the plain CSR otherwise
+Backend chooseBackend(uint64_t n, uint64_t m, const Calibration &calibration) {
+    if (n > 0 && double(m) / (double(n) * double(n)) >= calibration.denseDensity) {
+        return Backend::Bitset;
+    }
+    if (m >= calibration.compressedEdges) {
+        return Backend::Compressed;
+    }
+    return Backend::CSR;
+}
+
+// Random graph with 'n' vertices and 'm' edges for the calibration
+Graph<uint32_t> randomGraph(uint32_t n, uint64_t m, mt19937 &random) {
+    uniform_int_distribution<uint32_t> vertex(1, n);
+    Graph<uint32_t> g(n);
+    for (uint64_t i = 0; i < m; ++i) {
+        g.addEdge(vertex(random), vertex(random));
+    }
+    return g;
+}
+
+// Best of three SCC runs of 'g' in milliseconds, without output
+template <class G>
+double timeSCC(const G &g, SCCWorkspace<uint32_t> &ws) {
+    double best = HUGE_VAL;
+    for (int run = 0; run < 3; ++run) {
+        auto start = chrono::steady_clock::now();
+        size_t components = 0;
+        forEachSCC(g, ws, [&](const vector<uint32_t> &) { ++components; });
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Measure the crossover points on this host and store them at 'path'. A crossover is
+// the first point from which the other layout wins at every larger size of the sweep:
+//  - the density from which the bitset beats CSR, on 2048 vertices with the density
+//    doubling from 1/1024 to 1/2
+//  - the size from which compressed CSR beats CSR, at average degree 8 with the
+//    vertex count doubling from 2^14 to 2^21
+int runCalibration(const string &path) {
+    mt19937 random(1);
+    SCCWorkspace<uint32_t> ws;
+    Calibration calibration;
+
+    calibration.denseDensity = HUGE_VAL;
+    const uint32_t denseN = 2048;
+    for (double density = 1.0 / 1024; density <= 0.5; density *= 2) {
+        Graph<uint32_t> g = randomGraph(denseN, uint64_t(density * denseN * denseN), random);
+        vector<uint32_t> identity(denseN + 1);
+        for (uint32_t v = 0; v <= denseN; ++v) {
+            identity[v] = v;
+        }
+        double csrMs = timeSCC(CSRGraph<uint32_t>(g, identity), ws);
+        double bitsetMs = timeSCC(BitsetGraph<uint32_t>(g, identity), ws);
+        cerr << "density " << density << " csr_ms " << csrMs << " bitset_ms " << bitsetMs << endl;
+        if (bitsetMs >= csrMs) {
+            calibration.denseDensity = HUGE_VAL;
+        } else if (std::isinf(calibration.denseDensity)) {
+            calibration.denseDensity = density;
+        }
+    }
+
+    calibration.compressedEdges = UINT64_MAX;
+    for (uint32_t n = 1 << 14; n <= (1u << 21); n *= 2) {
+        uint64_t m = 8 * uint64_t(n);
+        Graph<uint32_t> g = randomGraph(n, m, random);
+        vector<uint32_t> identity(n + 1);
+        for (uint32_t v = 0; v <= n; ++v) {
+            identity[v] = v;
+        }
+        double csrMs = timeSCC(CSRGraph<uint32_t>(g, identity), ws);
+        double compressedMs = timeSCC(CompressedGraph<uint32_t>(g, identity), ws);
+        cerr << "edges " << m << " csr_ms " << csrMs << " compressed_ms " << compressedMs << endl;
+        if (compressedMs >= csrMs) {
+            calibration.compressedEdges = UINT64_MAX;
+        } else if (calibration.compressedEdges == UINT64_MAX) {
+            calibration.compressedEdges = m;
+        }
+    }
+
+    if (!saveCalibration(path, calibration)) {
+        cerr << "Cannot write " << path << endl;
+        return 1;
+    }
+    cerr << "Calibration stored in " << path << endl;
+    return 0;
+}
+
+// What main parsed from the command line for one in-memory SCC run
+struct RunOptions {
+    Reorder reorder = Reorder::None;
+    bool timing = false;
+    Backend backend = Backend::List;
+    string calibrationPath;  // Read by --backend=auto
+    bool dedup = false;
+    SCCOptions scc;
+    BuildOptions build;
+    MemoryPolicy memory;
+};
+
+// Call f with a value of the narrowest vertex id type for a graph with 'n' vertices.
+// The loops over vertices run up to n + 1, so that has to fit below the type's maximum.
+template <class F>
+int withVertexType(uint64_t n, F f) {
+    if (n + 2 <= UINT16_MAX) {
+        return f(uint16_t());
+    }
+    if (n + 2 <= UINT32_MAX) {
+        return f(uint32_t());
+    }
+    return f(uint64_t());
+}
+
+// Load a graph with 'n' vertices and 'm' edges using vertex ids of type V, preprocess
+// it as the options ask and print its SCCs. The header was already read: from 'in'
+// with --dedup, from cin otherwise.
+template <class V>
+int runSCC(V n, uint64_t m, IntScanner *in, const RunOptions &options, chrono::steady_clock::time_point start) {
+    double loadMs = 0;
+    Graph<V> g(0);
+    CSRGraph<V> built;
+    unique_ptr<CompressedGraph<V>> compressedGraph;
+    BuildStats buildStats;
+    double buildMs = 0;
+
+    // Pick the layout; --backend=auto decides from the size with the host's calibration.
+    // Without --dedup the graph keeps the header's edge count, so that is known up front.
+    Backend backend = options.backend;
+    if (backend == Backend::Auto && !options.dedup) {
+        backend = chooseBackend(n, m, loadCalibration(options.calibrationPath));
+    }
+
+    if (options.dedup) {
+        // Read the raw edges as sort keys and build the CSR in parallel
+        if (n >= UINT32_MAX) {
+            cerr << "--dedup packs vertex ids into 32 bits, the graph has " << n << " vertices" << endl;
+            return 1;
+        }
+        vector<uint64_t> edges;
+        {
+            TRACE_SPAN("load");
+            edges.reserve(min(m, uint64_t(1) << 20));  // Grown as the edges arrive, m is unchecked
+            for (uint64_t i = 0; i < m; ++i) {
+                long u, v;
+                if (!in->next(u) || !in->next(v) || u < 1 || u > (long)n || v < 1 || v > (long)n) {
+                    cerr << "Bad edge " << i + 1 << endl;
+                    return 1;
+                }
+                edges.push_back(packEdge(u, v));
+            }
+        }
+        loadMs = elapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        GraphArray<size_t> offsets;
+        GraphArray<V> targets;
+        BuildOptions buildOptions = options.build;
+        buildOptions.threads = options.scc.threads;
+        buildStats = buildCSR(n, edges, buildOptions, offsets, targets);
+        built = CSRGraph<V>(n, move(offsets), move(targets));
+        buildMs = elapsedMs(start);
+        if (backend == Backend::Auto) {
+            backend = chooseBackend(n, built.getNumEdges(), loadCalibration(options.calibrationPath));
+        }
+    }
+    else if (backend == Backend::Compressed) {
+        TRACE_SPAN("load");
+
+        // Encode straight from a log of the input edges: the adjacency lists are never built
+        EdgeLog<V> log(n);
+        for (uint64_t i = 0; i < m; ++i) {
+            uint64_t u, v;
+            if (!(cin >> u >> v) || u < 1 || u > n || v < 1 || v > n) {
+                cerr << "Bad edge " << i + 1 << endl;
+                return 1;
+            }
+            log.addEdge(u, v);
+        }
+        compressedGraph.reset(new CompressedGraph<V>(log));
+        loadMs = elapsedMs(start);
+    }
+    else {
+        TRACE_SPAN("load");
+
+        g = Graph<V>(n);  // Create a graph with 'n' vertices
+
+        // Input: Read the 'm' edges
+        for (uint64_t i = 0; i < m; ++i) {
+            uint64_t u, v;
+            if (!(cin >> u >> v) || u < 1 || u > n || v < 1 || v > n) {  // Read edge from vertex u to vertex v
+                cerr << "Bad edge " << i + 1 << endl;
+                return 1;
+            }
+            g.addEdge(u, v);  // Add the edge to the graph
+        }
+        loadMs = elapsedMs(start);
+    }
+
+    // The deduplicated CSR is traversed as it is unless another layout or a relabeling
+    // is asked for; the compressed graph read from the input only if no relabeling is
+    bool useBuilt = options.dedup && options.reorder == Reorder::None &&
+                    (backend == Backend::List || backend == Backend::CSR);
+    bool useLoaded = useBuilt || (compressedGraph && options.reorder == Reorder::None);
+
+    // Optional preprocessing: relabel the vertices and rebuild the graph as a CSR, a
+    // matrix or a compressed graph (with the identity labels unless --reorder is given)
+    start = chrono::steady_clock::now();
+    CSRGraph<V> relabeled;
+    unique_ptr<BitsetGraph<V>> bitsetGraph;
+    vector<V> originalId;
+    bool relabel = !useLoaded && (options.reorder != Reorder::None || backend != Backend::List);
+    auto relabelFrom = [&](const auto &source) {
+        TRACE_SPAN("reorder");
+        vector<V> newId(n + 1);
+        if (options.reorder != Reorder::None) {
+            newId = computeOrdering<V>(source, options.reorder);
+        }
+        else {
+            for (V v = 0; v <= n; ++v) {
+                newId[v] = v;
+            }
+        }
+        originalId.assign(n + 1, 0);
+        for (V v = 1; v <= n; ++v) {
+            originalId[newId[v]] = v;
+        }
+
+        if (backend == Backend::Compressed) {
+            compressedGraph.reset(new CompressedGraph<V>(source, newId));
+        }
+        else if (backend == Backend::Bitset) {
+            bitsetGraph.reset(new BitsetGraph<V>(source, newId));
+        }
+        else {
+            relabeled = CSRGraph<V>(source, newId);
+        }
+    };
+    if (relabel) {
+        // Only the relabeled copy is traversed from here on
+        if (options.dedup) {
+            relabelFrom(built);
+            built = CSRGraph<V>();
+        }
+        else if (compressedGraph) {
+            relabelFrom(*compressedGraph);
+        }
+        else {
+            relabelFrom(g);
+            g = Graph<V>(0);
+        }
+    }
+    double reorderMs = elapsedMs(start);
+    size_t adjacencyBytes = useBuilt ? built.memoryBytes() : g.memoryBytes();
+    if (compressedGraph) {
+        adjacencyBytes = compressedGraph->memoryBytes();
+    }
+    else if (bitsetGraph) {
+        adjacencyBytes = bitsetGraph->memoryBytes();
+    }
+    else if (relabel) {
+        adjacencyBytes = relabeled.memoryBytes();
     }
 
     // Output: Print the strongly connected components (SCCs)
-    printSCCs(g);
+    start = chrono::steady_clock::now();
+    SCCWorkspace<V> ws;  // Scratch buffers reused by printSCCs
+    if (compressedGraph && !relabel) {
+        printSCCs(*compressedGraph, ws, options.scc);
+    }
+    else if (compressedGraph) {
+        printSCCsReordered(*compressedGraph, originalId, ws, options.scc);
+    }
+    else if (bitsetGraph) {
+        printSCCsReordered(*bitsetGraph, originalId, ws, options.scc);
+    }
+    else if (relabel) {
+        printSCCsReordered(relabeled, originalId, ws, options.scc);
+    }
+    else if (useBuilt) {
+        printSCCs(built, ws, options.scc);
+    }
+    else {
+        printSCCs(g, ws, options.scc);
+    }
+    {
+        TRACE_SPAN("output");
+        cout.flush();
+    }
+
+    if (options.timing) {
+        cerr << "load_ms " << loadMs << " reorder_ms " << reorderMs << " scc_ms " << elapsedMs(start)
+             << " adjacency_bytes " << adjacencyBytes << " peak_rss_bytes " << peakRssBytes();
+        if (options.scc.trim) {
+            cerr << " trimmed " << ws.trimmed.size() << " of " << n;
+        }
+        if (options.backend != Backend::List) {
+            cerr << " backend " << BACKEND_NAMES[(int)backend];
+        }
+        if (options.dedup) {
+            cerr << " build_ms " << buildMs << " duplicates " << buildStats.duplicates << " self_loops "
+                 << buildStats.selfLoops;
+        }
+        if (!options.memory.isDefault()) {
+            MemoryStats memory = memoryStats();
+            cerr << " pages " << PAGE_MODE_NAMES[(int)options.memory.pages] << " numa "
+                 << NUMA_MODE_NAMES[(int)options.memory.numa] << " mapped_bytes " << memory.mappedBytes
+                 << " huge_bytes " << memory.hugeBytes << " numa_nodes " << memory.nodes << " placed_bytes "
+                 << memory.placedBytes << " hugetlb_fallbacks " << memory.fallbacks;
+        }
+        cerr << endl;
+    }
 
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    RunOptions options;
+    options.calibrationPath = defaultCalibrationPath();
+    bool calibrate = false;
+    bool external = false;
+    ExternalOptions externalOptions;
+    bool batch = false;
+    vector<string> batchInputs;
+    int jobs = max(1u, thread::hardware_concurrency());
+
+    // Options: --reorder=none|bfs|rcm|degree relabels vertices for locality before the SCC search,
+    // --time prints the load and SCC phase durations to stderr, --trim peels the trivial SCCs
+    // before the DFS passes and --threads=N lets the trimming stage use N workers.
+    // --compressed traverses a delta + varint encoded copy of the graph (--backend=compressed);
+    // --backend=list|csr|bitset|compressed picks the layout, --backend=auto chooses it from n
+    // and m with the crossover points --calibrate measured and stored in --calibration=FILE.
+    // --external keeps the edges on disk (see ExternalSCC.hpp); it reads --input=FILE or stdin,
+    // --binary marks the input as a binary edge file, --save-binary=FILE only converts the input,
+    // --mem-limit=MB bounds the memory used and --tmpdir=DIR says where edges are spilled.
+    // --dedup builds a CSR without repeated edges on --threads workers (see buildCSR),
+    // --drop-self-loops also removes the edges v -> v.
+    // --pages=default|thp|hugetlb and --numa=off|interleave say how the graph arrays
+    // are backed and placed (see GraphMemory.hpp).
+    // --batch computes the SCCs of many concatenated graphs from --input=FILE or stdin,
+    // --batch-dir=DIR of every graph in the files of DIR, on --jobs=N threads (see runBatch).
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--reorder=", 0) == 0 && parseReorder(arg.substr(10), options.reorder)) {
+            continue;
+        }
+        if (arg == "--time") {
+            options.timing = true;
+            externalOptions.stats = true;
+            continue;
+        }
+        if (arg == "--compressed") {
+            options.backend = Backend::Compressed;
+            continue;
+        }
+        if (arg.rfind("--backend=", 0) == 0 && parseBackend(arg.substr(10), options.backend)) {
+            continue;
+        }
+        if (arg.rfind("--calibration=", 0) == 0) {
+            options.calibrationPath = arg.substr(14);
+            continue;
+        }
+        if (arg == "--calibrate") {
+            calibrate = true;
+            continue;
+        }
+        if (arg == "--trim") {
+            options.scc.trim = true;
+            continue;
+        }
+        if (arg.rfind("--threads=", 0) == 0 && atoi(arg.c_str() + 10) > 0) {
+            options.scc.threads = atoi(arg.c_str() + 10);
+            continue;
+        }
+        if (arg == "--external") {
+            external = true;
+            continue;
+        }
+        if (arg.rfind("--input=", 0) == 0) {
+            externalOptions.input = arg.substr(8);
+            continue;
+        }
+        if (arg == "--binary") {
+            externalOptions.binaryInput = true;
+            continue;
+        }
+        if (arg.rfind("--save-binary=", 0) == 0) {
+            externalOptions.saveBinary = arg.substr(14);
+            external = true;
+            continue;
+        }
+        if (arg.rfind("--mem-limit=", 0) == 0 && atol(arg.c_str() + 12) > 0) {
+            externalOptions.memoryLimit = size_t(atol(arg.c_str() + 12)) << 20;
+            continue;
+        }
+        if (arg.rfind("--tmpdir=", 0) == 0) {
+            externalOptions.tmpDir = arg.substr(9);
+            continue;
+        }
+        if (arg == "--dedup") {
+            options.dedup = true;
+            continue;
+        }
+        if (arg == "--drop-self-loops") {
+            options.dedup = true;
+            options.build.dropSelfLoops = true;
+            continue;
+        }
+        if (arg.rfind("--pages=", 0) == 0 && parsePageMode(arg.substr(8), options.memory.pages)) {
+            continue;
+        }
+        if (arg.rfind("--numa=", 0) == 0 && parseNumaMode(arg.substr(7), options.memory.numa)) {
+            continue;
+        }
+        if (arg == "--batch") {
+            batch = true;
+            continue;
+        }
+        if (arg.rfind("--batch-dir=", 0) == 0 && listBatchDir(arg.substr(12), batchInputs)) {
+            batch = true;
+            continue;
+        }
+        if (arg.rfind("--jobs=", 0) == 0 && atoi(arg.c_str() + 7) > 0) {
+            jobs = atoi(arg.c_str() + 7);
+            continue;
+        }
+        cerr << "Usage: " << argv[0] << " [--reorder=none|bfs|rcm|degree] [--compressed] [--trim] [--threads=N]"
+             << " [--backend=list|csr|bitset|compressed|auto] [--dedup] [--drop-self-loops]"
+             << " [--pages=default|thp|hugetlb] [--numa=off|interleave] [--time] < graph" << endl;
+        cerr << "       " << argv[0] << " --calibrate [--calibration=FILE]" << endl;
+        cerr << "       " << argv[0] << " --external [--input=FILE [--binary]] [--mem-limit=MB] [--tmpdir=DIR]"
+             << " [--save-binary=FILE] [--time]" << endl;
+        cerr << "       " << argv[0] << " --batch [--input=FILE] | --batch-dir=DIR [--jobs=N] [--trim] [--time]" << endl;
+        return 1;
+    }
+    setMemoryPolicy(options.memory);
+    if (calibrate) {
+        return runCalibration(options.calibrationPath);
+    }
+    if (batch) {
+        if (!externalOptions.input.empty()) {
+            batchInputs.push_back(externalOptions.input);
+        }
+        return runBatch(batchInputs, jobs, options.scc, options.timing);
+    }
+    if (externalOptions.binaryInput && externalOptions.input.empty()) {
+        cerr << "--binary needs --input=FILE" << endl;
+        return 1;
+    }
+    if (external) {
+        return runExternalSCC(externalOptions);
+    }
+    auto start = chrono::steady_clock::now();
+    long header[2] = {0, 0};  // n and m
+    unique_ptr<IntScanner> scanner;
+    if (options.dedup) {
+        scanner.reset(new IntScanner(stdin));
+        if (!scanner->next(header[0]) || !scanner->next(header[1])) {
+            header[0] = -1;
+        }
+    }
+    else {
+        cin >> header[0] >> header[1];  // Input: Read the number of vertices (n) and edges (m)
+    }
+    if (header[0] < 0 || header[1] < 0) {
+        cerr << "Bad graph header" << endl;
+        return 1;
+    }
+
+    // The vertex id width is chosen once here; everything below runs on that type
+    return withVertexType(header[0], [&](auto vertex) {
+        using V = decltype(vertex);
+        return runSCC<V>(header[0], header[1], scanner.get(), options, start);
+    });
+}
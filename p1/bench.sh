@@ -0,0 +1,96 @@
+#!/bin/bash
+
+# Benchmark the SCC engine on large generated graphs: vertex reordering and the
+# compressed (delta + varint) adjacency, the automatic layout choice and the huge page and NUMA
+# placements of the CSR arrays; then the batch mode on many small graphs
+
+# Directory to store the generated graphs and the timing results
+bench_dir="bench_results"
+mkdir -p "$bench_dir"
+
+num_nodes=${NUM_NODES:-1000000}
+num_edges=${NUM_EDGES:-5000000}
+configs=("--reorder=none" "--reorder=bfs" "--reorder=rcm" "--reorder=degree"
+         "--compressed" "--reorder=rcm --compressed" "--backend=csr" "--backend=auto"
+         "--backend=csr --pages=thp" "--backend=csr --pages=hugetlb" "--backend=csr --numa=interleave"
+         "--backend=csr --pages=thp --numa=interleave")
+
+# Step 0: Generate the input graphs (skipped when they already exist)
+# random.txt: uniformly random edges, no locality to recover
+# grid.txt:   a directed grid with back edges whose vertex ids were shuffled, so the
+#             structure is local but the ids are not
+graph_dir="$bench_dir/graphs"
+mkdir -p "$graph_dir"
+random_file="$graph_dir/random.txt"
+grid_file="$graph_dir/grid.txt"
+small_file="$graph_dir/small.txt"
+num_small=${NUM_SMALL:-100000}
+
+if [[ ! -f "$random_file" ]]; then
+    echo "Generating $random_file with $num_nodes nodes and $num_edges edges..."
+    awk -v n="$num_nodes" -v m="$num_edges" 'BEGIN {
+        srand(1);
+        print n, m;
+        for (i = 0; i < m; i++) print int(rand() * n) + 1, int(rand() * n) + 1;
+    }' > "$random_file"
+fi
+
+if [[ ! -f "$grid_file" ]]; then
+    echo "Generating $grid_file with about $num_nodes nodes..."
+    awk -v n="$num_nodes" 'BEGIN {
+        srand(2);
+        side = int(sqrt(n)); n = side * side;
+        for (v = 1; v <= n; v++) id[v] = v;
+        for (v = n; v > 1; v--) { j = int(rand() * v) + 1; t = id[v]; id[v] = id[j]; id[j] = t; }
+        m = 0;
+        for (r = 0; r < side; r++) for (c = 0; c < side; c++) {
+            v = r * side + c + 1;
+            if (c + 1 < side) edge[m++] = id[v] " " id[v + 1];
+            if (r + 1 < side) edge[m++] = id[v] " " id[v + side];
+            if (c > 0 && rand() < 0.5) edge[m++] = id[v] " " id[v - 1];
+            if (r > 0 && rand() < 0.5) edge[m++] = id[v] " " id[v - side];
+        }
+        print n, m;
+        for (i = 0; i < m; i++) print edge[i];
+    }' > "$grid_file"
+fi
+
+# small.txt: many small random graphs back to back, the input of the batch mode
+if [[ ! -f "$small_file" ]]; then
+    echo "Generating $small_file with $num_small graphs..."
+    awk -v k="$num_small" 'BEGIN {
+        srand(3);
+        for (g = 0; g < k; g++) {
+            n = int(rand() * 50) + 1; m = int(rand() * 2 * n);
+            print n, m;
+            for (i = 0; i < m; i++) print int(rand() * n) + 1, int(rand() * n) + 1;
+        }
+    }' > "$small_file"
+fi
+
+# Step 1: Build an optimized binary
+echo "Compiling with optimizations..."
+make clean > /dev/null
+make CFLAGS=-O2 > /dev/null || exit 1
+
+# Step 2: Run every configuration on every graph and collect the phase timings
+results_file="$bench_dir/reorder.txt"
+: > "$results_file"
+for input in "$random_file" "$grid_file"; do
+    for config in "${configs[@]}"; do
+        echo "Running $(basename "$input") with $config..."
+        timing=$(./p1 $config --time < "$input" 2>&1 > /dev/null)
+        echo "$(basename "$input") $config $timing" | tee -a "$results_file"
+    done
+done
+
+# Step 3: Batch throughput with one job and with one job per core
+batch_file="$bench_dir/batch.txt"
+: > "$batch_file"
+for jobs in 1 "$(nproc)"; do
+    echo "Running $(basename "$small_file") with --batch --jobs=$jobs..."
+    timing=$(./p1 --batch --jobs="$jobs" --time < "$small_file" 2>&1 > /dev/null)
+    echo "$(basename "$small_file") $timing" | tee -a "$batch_file"
+done
+
+echo "Benchmark complete. Results are stored in $results_file and $batch_file."